@@ -0,0 +1,621 @@
+// Packed, cache-blocked double-precision GEMM shared by the matrix multiply driver
+// and other assignments. All matrices are row-major; see dgemm below for the
+// BLAS-like entry point.
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <omp.h>
+
+// Register block of C held by the micro-kernel: MR rows x NR columns
+const int MR = 6;
+const int NR = 8;
+
+// Whether an operand is used as stored or transposed
+enum Transpose
+{
+  NoTrans,
+  Trans
+};
+
+typedef void (*micro_kernel_t)(int kc, const double *Ap, const double *Bp, double *C, int ldc);
+
+// Packs an mc x kc block of alpha * op(A) into MR-row micro-panels stored k-major,
+// zero padded at the edge. A points at the block's first element.
+inline void pack_A(Transpose transA, const double *A, int lda, int mc, int kc, double alpha, double *Ap)
+{
+  for (int i = 0; i < mc; i += MR)
+  {
+    int ib = std::min(MR, mc - i);
+    for (int k = 0; k < kc; k++)
+    {
+      if (transA == NoTrans)
+      {
+        for (int r = 0; r < ib; r++)
+          Ap[r] = alpha * A[(long)(i + r) * lda + k];
+      }
+      else
+      {
+        const double *a = A + (long)k * lda + i;
+        for (int r = 0; r < ib; r++)
+          Ap[r] = alpha * a[r];
+      }
+      for (int r = ib; r < MR; r++)
+        Ap[r] = 0.0;
+      Ap += MR;
+    }
+  }
+}
+
+// Packs a kc x nc block of op(B) into NR-column micro-panels stored k-major, zero
+// padded at the edge. B points at the block's first element.
+inline void pack_B(Transpose transB, const double *B, int ldb, int kc, int nc, double *Bp)
+{
+  for (int j = 0; j < nc; j += NR)
+  {
+    int jb = std::min(NR, nc - j);
+    for (int k = 0; k < kc; k++)
+    {
+      if (transB == NoTrans)
+      {
+        const double *b = B + (long)k * ldb + j;
+        for (int c = 0; c < jb; c++)
+          Bp[c] = b[c];
+      }
+      else
+      {
+        for (int c = 0; c < jb; c++)
+          Bp[c] = B[(long)(j + c) * ldb + k];
+      }
+      for (int c = jb; c < NR; c++)
+        Bp[c] = 0.0;
+      Bp += NR;
+    }
+  }
+}
+
+// C[MR x NR] += Ap * Bp, portable version used when AVX2/FMA is not available
+inline void micro_kernel_scalar(int kc, const double *Ap, const double *Bp, double *C, int ldc)
+{
+  double c[MR][NR] = {};
+  for (int k = 0; k < kc; k++)
+  {
+    for (int r = 0; r < MR; r++)
+    {
+      for (int j = 0; j < NR; j++)
+      {
+        c[r][j] += Ap[r] * Bp[j];
+      }
+    }
+    Ap += MR;
+    Bp += NR;
+  }
+  for (int r = 0; r < MR; r++)
+  {
+    for (int j = 0; j < NR; j++)
+    {
+      C[r * ldc + j] += c[r][j];
+    }
+  }
+}
+
+// C[MR x NR] += Ap * Bp with the whole 6x8 block of C kept in 12 ymm registers
+__attribute__((target("avx2,fma"))) inline void micro_kernel_avx2(int kc, const double *Ap, const double *Bp, double *C, int ldc)
+{
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+  __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+  for (int k = 0; k < kc; k++)
+  {
+    // packed panels are 64-byte aligned and NR doubles wide, so aligned loads are safe
+    __m256d b0 = _mm256_load_pd(Bp);
+    __m256d b1 = _mm256_load_pd(Bp + 4);
+    __m256d a;
+
+    a = _mm256_broadcast_sd(Ap + 0);
+    c00 = _mm256_fmadd_pd(a, b0, c00);
+    c01 = _mm256_fmadd_pd(a, b1, c01);
+    a = _mm256_broadcast_sd(Ap + 1);
+    c10 = _mm256_fmadd_pd(a, b0, c10);
+    c11 = _mm256_fmadd_pd(a, b1, c11);
+    a = _mm256_broadcast_sd(Ap + 2);
+    c20 = _mm256_fmadd_pd(a, b0, c20);
+    c21 = _mm256_fmadd_pd(a, b1, c21);
+    a = _mm256_broadcast_sd(Ap + 3);
+    c30 = _mm256_fmadd_pd(a, b0, c30);
+    c31 = _mm256_fmadd_pd(a, b1, c31);
+    a = _mm256_broadcast_sd(Ap + 4);
+    c40 = _mm256_fmadd_pd(a, b0, c40);
+    c41 = _mm256_fmadd_pd(a, b1, c41);
+    a = _mm256_broadcast_sd(Ap + 5);
+    c50 = _mm256_fmadd_pd(a, b0, c50);
+    c51 = _mm256_fmadd_pd(a, b1, c51);
+
+    Ap += MR;
+    Bp += NR;
+  }
+
+  // rows of C are only 32-byte aligned when N is a multiple of 4, so use unaligned access here
+  __m256d acc[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+  for (int r = 0; r < MR; r++)
+  {
+    double *c = C + r * ldc;
+    _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), acc[r][0]));
+    _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), acc[r][1]));
+  }
+}
+
+inline bool cpu_has_avx2_fma()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+// Picks the micro-kernel once using CPUID
+inline micro_kernel_t select_micro_kernel()
+{
+  return cpu_has_avx2_fma() ? micro_kernel_avx2 : micro_kernel_scalar;
+}
+
+inline const char *micro_kernel_name(micro_kernel_t kernel)
+{
+  return kernel == micro_kernel_avx2 ? "avx2-fma 6x8" : "scalar 6x8";
+}
+
+// C[mc x nc] += packed A block * packed B block, edge micro-tiles go through a scratch tile
+inline void macro_kernel(int mc, int nc, int kc, const double *Ap, const double *Bp, double *C, int ldc, micro_kernel_t kernel)
+{
+  alignas(32) double tmp[MR * NR];
+  for (int j = 0; j < nc; j += NR)
+  {
+    int jb = std::min(NR, nc - j);
+    for (int i = 0; i < mc; i += MR)
+    {
+      int ib = std::min(MR, mc - i);
+      const double *a = Ap + i * kc;
+      const double *b = Bp + j * kc;
+      if (ib == MR && jb == NR)
+      {
+        kernel(kc, a, b, &C[i * ldc + j], ldc);
+      }
+      else
+      {
+        memset(tmp, 0, sizeof(tmp));
+        kernel(kc, a, b, tmp, NR);
+        for (int r = 0; r < ib; r++)
+        {
+          for (int c = 0; c < jb; c++)
+          {
+            C[(i + r) * ldc + j + c] += tmp[r * NR + c];
+          }
+        }
+      }
+    }
+  }
+}
+
+inline int round_up(int x, int multiple)
+{
+  return (x + multiple - 1) / multiple * multiple;
+}
+
+// Cache blocking of the packed multiply in BLIS terms: an mc x kc block of A is
+// packed to stay in L2, a kc x nc panel of B to stay in L3, and a kc x NR sliver of
+// that panel is streamed from L1 by the micro-kernel
+struct Blocking
+{
+  int mc, kc, nc;
+};
+
+const Blocking DEFAULT_BLOCKING = {96, 256, 2048};
+
+// One cubic tile for all three loops, rounded up to the micro-kernel shape for M and N
+inline Blocking cubic_blocking(int tileSize)
+{
+  return {round_up(tileSize, MR), tileSize, round_up(tileSize, NR)};
+}
+
+// Scales rows [i0, i1) x columns [j0, j1) of C by beta; beta == 0 overwrites C so
+// that uninitialised memory (NaN/Inf) never leaks into the result
+inline void scale_block(double *C, int ldc, int i0, int i1, int j0, int j1, double beta)
+{
+  if (beta == 1.0)
+    return;
+  for (int i = i0; i < i1; i++)
+  {
+    double *c = C + (long)i * ldc;
+    if (beta == 0.0)
+    {
+      memset(c + j0, 0, (j1 - j0) * sizeof(double));
+    }
+    else
+    {
+      for (int j = j0; j < j1; j++)
+        c[j] *= beta;
+    }
+  }
+}
+
+// C[i0:i1, j0:j1] += alpha * op(A)[i0:i1, :] * op(B)[:, j0:j1] over the whole K range,
+// packing into the caller's buffers (blk.mc * blk.kc and blk.kc * blk.nc doubles)
+inline void gemm_block(Transpose transA, Transpose transB, int K, double alpha,
+                       const double *A, int lda, const double *B, int ldb, double *C, int ldc,
+                       const Blocking &blk, int i0, int i1, int j0, int j1, double *Ap, double *Bp)
+{
+  static micro_kernel_t kernel = select_micro_kernel();
+
+  for (int jj = j0; jj < j1; jj += blk.nc)
+  {
+    int nb = std::min(blk.nc, j1 - jj);
+    for (int kk = 0; kk < K; kk += blk.kc)
+    {
+      int kb = std::min(blk.kc, K - kk);
+      const double *b = transB == NoTrans ? B + (long)kk * ldb + jj : B + (long)jj * ldb + kk;
+      pack_B(transB, b, ldb, kb, nb, Bp);
+      for (int ii = i0; ii < i1; ii += blk.mc)
+      {
+        int mb = std::min(blk.mc, i1 - ii);
+        const double *a = transA == NoTrans ? A + (long)ii * lda + kk : A + (long)kk * lda + ii;
+        pack_A(transA, a, lda, mb, kb, alpha, Ap);
+        macro_kernel(mb, nb, kb, Ap, Bp, C + (long)ii * ldc + jj, ldc, kernel);
+      }
+    }
+  }
+}
+
+// Layout of threads over the C tile space: rows x cols threads, thread t owns grid cell (t / cols, t % cols)
+struct ThreadGrid
+{
+  int rows, cols;
+};
+
+// Factors numThreads into a 2D grid whose cells are as close to square as the M x N shape allows
+inline ThreadGrid make_thread_grid(int numThreads, int M, int N)
+{
+  ThreadGrid best = {numThreads, 1};
+  double bestCost = -1.0;
+  for (int r = 1; r <= numThreads; r++)
+  {
+    if (numThreads % r != 0)
+      continue;
+    int c = numThreads / r;
+    double cost = std::fabs(static_cast<double>(M) / r - static_cast<double>(N) / c);
+    if (bestCost < 0 || cost < bestCost)
+    {
+      bestCost = cost;
+      best = {r, c};
+    }
+  }
+  return best;
+}
+
+// Splits [0, total) into `parts` contiguous ranges made of whole tiles and returns range `idx` as [lo, hi)
+inline void tile_range(int total, int tile, int parts, int idx, int &lo, int &hi)
+{
+  int tiles = (total + tile - 1) / tile;
+  lo = std::min(total, (int)((long)tiles * idx / parts) * tile);
+  hi = std::min(total, (int)((long)tiles * (idx + 1) / parts) * tile);
+}
+
+// Block of C owned by thread t of the grid: rows [i0, i1) x columns [j0, j1). The split is
+// in micro-kernel units (MR rows, NR columns), not in mc/nc blocks, so a thread only goes
+// idle when C has fewer micro-tiles than the grid has cells in that direction; each thread
+// then runs the mc/nc loops over its own block.
+inline void thread_tile(const ThreadGrid &grid, int t, int M, int N, int &i0, int &i1, int &j0, int &j1)
+{
+  tile_range(M, MR, grid.rows, t / grid.cols, i0, i1);
+  tile_range(N, NR, grid.cols, t % grid.cols, j0, j1);
+}
+
+// Row-major BLAS-style multiply C = alpha * op(A) * op(B) + beta * C, where op(A) is
+// M x K and op(B) is K x N. lda, ldb and ldc are the row strides of the stored
+// matrices, so sub-matrix views and transposes need no copies. With numThreads > 1
+// the ii/jj tile space is split over a 2D grid of threads and every thread runs the
+// full K loop for its own block of C, so no reduction on C is needed.
+inline void dgemm(Transpose transA, Transpose transB, int M, int N, int K, double alpha,
+                  const double *A, int lda, const double *B, int ldb, double beta, double *C, int ldc,
+                  const Blocking &blk = DEFAULT_BLOCKING, int numThreads = 1)
+{
+  if (M <= 0 || N <= 0)
+    return;
+  ThreadGrid grid = make_thread_grid(numThreads, M, N);
+
+#pragma omp parallel num_threads(grid.rows * grid.cols) if (numThreads > 1)
+  {
+    int t = omp_get_thread_num();
+    int i0, i1, j0, j1;
+    thread_tile(grid, t, M, N, i0, i1, j0, j1);
+
+    scale_block(C, ldc, i0, i1, j0, j1, beta);
+    if (alpha != 0.0 && K > 0 && i0 < i1 && j0 < j1)
+    {
+      // thread-private pack buffers, first touched by their owner and no larger than its block
+      Blocking own = {std::min(blk.mc, round_up(i1 - i0, MR)), blk.kc, std::min(blk.nc, round_up(j1 - j0, NR))};
+      double *Ap = (double *)_mm_malloc(own.mc * own.kc * sizeof(double), 64);
+      double *Bp = (double *)_mm_malloc(own.kc * own.nc * sizeof(double), 64);
+      gemm_block(transA, transB, K, alpha, A, lda, B, ldb, C, ldc, own, i0, i1, j0, j1, Ap, Bp);
+      _mm_free(Ap);
+      _mm_free(Bp);
+    }
+  }
+}
+
+// Z = X + sign * Y for rows x cols views with their own row strides, rows split over numThreads
+inline void matrix_add(int rows, int cols, const double *X, int ldx, double sign, const double *Y, int ldy, double *Z, int ldz,
+                       int numThreads = 1)
+{
+#pragma omp parallel for num_threads(numThreads) schedule(static) if (numThreads > 1 && (long)rows * cols >= 65536)
+  for (int i = 0; i < rows; i++)
+  {
+    const double *x = X + (long)i * ldx;
+    const double *y = Y + (long)i * ldy;
+    double *z = Z + (long)i * ldz;
+    for (int j = 0; j < cols; j++)
+      z[j] = x[j] + sign * y[j];
+  }
+}
+
+// Doubles of arena needed below one Strassen-Winograd level of an m x k by k x n
+// product: the two temporaries X (an A quadrant, later a product) and Y (a B quadrant)
+// plus the workspace of the children, which run one after another and share it
+inline long strassen_workspace(int m, int n, int k, int crossover)
+{
+  if (std::min(m, std::min(n, k)) <= crossover)
+    return 0;
+  long hm = m / 2, hn = n / 2, hk = k / 2;
+  return hm * std::max(hk, hn) + hk * hn + strassen_workspace(hm, hn, hk, crossover);
+}
+
+// C = A*B by Strassen-Winograd recursion (7 products, 15 additions per level) down to
+// the blocked dgemm once a dimension reaches the crossover. Every dimension must be
+// divisible by 2 for as many levels as the recursion goes; ws is this level's share
+// of the arena. Uses the two-temporary schedule of Boyer, Dumas, Pernet and Zhou:
+// products are written straight into C's quadrants and combined there, so a level
+// needs only X and Y. The leaf products and the additions use numThreads threads.
+inline void strassen_recursive(int m, int n, int k, const double *A, int lda, const double *B, int ldb,
+                               double *C, int ldc, int crossover, int numThreads, const Blocking &blk, double *ws)
+{
+  if (std::min(m, std::min(n, k)) <= crossover)
+  {
+    dgemm(NoTrans, NoTrans, m, n, k, 1.0, A, lda, B, ldb, 0.0, C, ldc, blk, numThreads);
+    return;
+  }
+
+  int hm = m / 2, hn = n / 2, hk = k / 2;
+  const double *A11 = A, *A12 = A + hk, *A21 = A + (long)hm * lda, *A22 = A21 + hk;
+  const double *B11 = B, *B12 = B + hn, *B21 = B + (long)hk * ldb, *B22 = B21 + hn;
+  double *C11 = C, *C12 = C + hn, *C21 = C + (long)hm * ldc, *C22 = C21 + hn;
+
+  // X holds an hm x hk operand sum or the hm x hn product P1; Y an hk x hn operand sum
+  double *X = ws, *Y = ws + (long)hm * std::max(hk, hn);
+  double *childWs = Y + (long)hk * hn;
+  int ldx = hk;
+  auto multiply = [&](const double *L, int ldl, const double *R, int ldr, double *P, int ldp) {
+    strassen_recursive(hm, hn, hk, L, ldl, R, ldr, P, ldp, crossover, numThreads, blk, childWs);
+  };
+  auto add = [&](int rows, int cols, const double *U, int ldu, double sign, const double *V, int ldv, double *Z, int ldz) {
+    matrix_add(rows, cols, U, ldu, sign, V, ldv, Z, ldz, numThreads);
+  };
+
+  add(hm, hk, A11, lda, -1.0, A21, lda, X, ldx);   // X = S3 = A11 - A21
+  add(hk, hn, B22, ldb, -1.0, B12, ldb, Y, hn);    // Y = T3 = B22 - B12
+  multiply(X, ldx, Y, hn, C21, ldc);               // C21 = P7 = S3 T3
+  add(hm, hk, A21, lda, 1.0, A22, lda, X, ldx);    // X = S1 = A21 + A22
+  add(hk, hn, B12, ldb, -1.0, B11, ldb, Y, hn);    // Y = T1 = B12 - B11
+  multiply(X, ldx, Y, hn, C22, ldc);               // C22 = P5 = S1 T1
+  add(hm, hk, X, ldx, -1.0, A11, lda, X, ldx);     // X = S2 = S1 - A11
+  add(hk, hn, B22, ldb, -1.0, Y, hn, Y, hn);       // Y = T2 = B22 - T1
+  multiply(X, ldx, Y, hn, C12, ldc);               // C12 = P6 = S2 T2
+  add(hm, hk, A12, lda, -1.0, X, ldx, X, ldx);     // X = S4 = A12 - S2
+  multiply(X, ldx, B22, ldb, C11, ldc);            // C11 = P3 = S4 B22
+  multiply(A11, lda, B11, ldb, X, hn);             // X = P1 = A11 B11
+  add(hm, hn, X, hn, 1.0, C12, ldc, C12, ldc);     // C12 = U2 = P1 + P6
+  add(hm, hn, C12, ldc, 1.0, C21, ldc, C21, ldc);  // C21 = U3 = U2 + P7
+  add(hm, hn, C12, ldc, 1.0, C22, ldc, C12, ldc);  // C12 = U4 = U2 + P5
+  add(hm, hn, C21, ldc, 1.0, C22, ldc, C22, ldc);  // C22 = U7 = U3 + P5
+  add(hm, hn, C12, ldc, 1.0, C11, ldc, C12, ldc);  // C12 = U5 = U4 + P3
+  add(hk, hn, Y, hn, -1.0, B21, ldb, Y, hn);       // Y = T4 = T2 - B21
+  multiply(A22, lda, Y, hn, C11, ldc);             // C11 = P4 = A22 T4
+  add(hm, hn, C21, ldc, -1.0, C11, ldc, C21, ldc); // C21 = U6 = U3 - P4
+  multiply(A12, lda, B21, ldb, C11, ldc);          // C11 = P2 = A12 B21
+  add(hm, hn, X, hn, 1.0, C11, ldc, C11, ldc);     // C11 = U1 = P1 + P2
+}
+
+// Number of Strassen-Winograd levels before the smallest dimension reaches the crossover
+inline int strassen_levels(int M, int N, int K, int crossover)
+{
+  int levels = 0;
+  int x = std::min(M, std::min(N, K));
+  while (x > crossover)
+  {
+    x = (x + 1) / 2;
+    levels++;
+  }
+  return levels;
+}
+
+// C = A*B using Strassen-Winograd above the crossover size. Dimensions are zero
+// padded up to a multiple of 2^levels when needed, and all padding and temporaries
+// come out of one arena allocated up front (its size in bytes is returned through
+// arenaBytes); the arena does not grow with numThreads, which goes to the leaf
+// products and the additions.
+inline void strassen_multiply(int M, int N, int K, const double *A, int lda, const double *B, int ldb,
+                              double *C, int ldc, int crossover, const Blocking &blk = DEFAULT_BLOCKING,
+                              int numThreads = 1, long *arenaBytes = nullptr)
+{
+  int levels = strassen_levels(M, N, K, crossover);
+  int pm = round_up(M, 1 << levels), pn = round_up(N, 1 << levels), pk = round_up(K, 1 << levels);
+  bool padded = pm != M || pn != N || pk != K;
+
+  long padSize = padded ? (long)pm * pk + (long)pk * pn + (long)pm * pn : 0;
+  long arenaSize = padSize + strassen_workspace(pm, pn, pk, crossover);
+  if (arenaBytes)
+    *arenaBytes = arenaSize * sizeof(double);
+  double *arena = (double *)_mm_malloc(std::max(arenaSize, 1L) * sizeof(double), 64);
+
+  const double *Ause = A, *Buse = B;
+  double *Cuse = C;
+  int ldaUse = lda, ldbUse = ldb, ldcUse = ldc;
+  if (padded)
+  {
+    double *Apad = arena, *Bpad = arena + (long)pm * pk;
+    Cuse = Bpad + (long)pk * pn;
+    memset(Apad, 0, padSize * sizeof(double));
+    for (int i = 0; i < M; i++)
+      memcpy(Apad + (long)i * pk, A + (long)i * lda, K * sizeof(double));
+    for (int k = 0; k < K; k++)
+      memcpy(Bpad + (long)k * pn, B + (long)k * ldb, N * sizeof(double));
+    Ause = Apad;
+    Buse = Bpad;
+    ldaUse = pk;
+    ldbUse = pn;
+    ldcUse = pn;
+  }
+
+  strassen_recursive(pm, pn, pk, Ause, ldaUse, Buse, ldbUse, Cuse, ldcUse, crossover, numThreads, blk, arena + padSize);
+
+  if (padded)
+  {
+    for (int i = 0; i < M; i++)
+      memcpy(C + (long)i * ldc, Cuse + (long)i * pn, N * sizeof(double));
+  }
+  _mm_free(arena);
+}
+
+// C = A*B for one small row-major product whose sizes are known at compile time, so
+// the compiler fully unrolls the inner loops and keeps each row of C in registers
+template <int M, int N, int K>
+__attribute__((always_inline)) inline void small_multiply_fixed(const double *__restrict A, const double *__restrict B, double *__restrict C)
+{
+  for (int i = 0; i < M; i++)
+  {
+    double c[N] = {};
+#pragma GCC unroll 32
+    for (int k = 0; k < K; k++)
+    {
+      double a = A[i * K + k];
+#pragma GCC unroll 32
+      for (int j = 0; j < N; j++)
+      {
+        c[j] += a * B[k * N + j];
+      }
+    }
+    memcpy(C + i * N, c, sizeof(c));
+  }
+}
+
+// Same product for sizes only known at run time
+inline void small_multiply_generic(const double *__restrict A, const double *__restrict B, double *__restrict C, int M, int N, int K)
+{
+  for (int i = 0; i < M; i++)
+  {
+    double *c = C + i * N;
+    for (int j = 0; j < N; j++)
+      c[j] = 0.0;
+    for (int k = 0; k < K; k++)
+    {
+      double a = A[i * K + k];
+      const double *b = B + k * N;
+      for (int j = 0; j < N; j++)
+        c[j] += a * b[j];
+    }
+  }
+}
+
+// Batch layouts: product b reads A[b], B[b] and writes C[b] through a pointer array,
+// or lives at a fixed stride from the first product in one contiguous buffer
+struct PointerArrayBatch
+{
+  const double *const *A, *const *B;
+  double *const *C;
+  const double *a(long b) const { return A[b]; }
+  const double *b(long b) const { return B[b]; }
+  double *c(long b) const { return C[b]; }
+};
+
+struct StridedBatch
+{
+  const double *A, *B;
+  double *C;
+  long strideA, strideB, strideC;
+  const double *a(long b) const { return A + b * strideA; }
+  const double *b(long b) const { return B + b * strideB; }
+  double *c(long b) const { return C + b * strideC; }
+};
+
+// Runs products [begin, end) of the batch with the unrolled kernel
+template <int S, class Batch>
+void batched_multiply_range(const Batch &batch, long begin, long end)
+{
+  for (long b = begin; b < end; b++)
+  {
+    small_multiply_fixed<S, S, S>(batch.a(b), batch.b(b), batch.c(b));
+  }
+}
+
+// The same loop compiled for AVX2/FMA
+template <int S, class Batch>
+__attribute__((target("avx2,fma"))) void batched_multiply_range_avx2(const Batch &batch, long begin, long end)
+{
+  for (long b = begin; b < end; b++)
+  {
+    small_multiply_fixed<S, S, S>(batch.a(b), batch.b(b), batch.c(b));
+  }
+}
+
+template <int S, class Batch>
+void batched_multiply_fixed(const Batch &batch, long count, int numThreads)
+{
+  static bool avx2 = cpu_has_avx2_fma();
+#pragma omp parallel num_threads(numThreads)
+  {
+    int t = omp_get_thread_num(), nt = omp_get_num_threads();
+    long begin = count * t / nt, end = count * (t + 1) / nt;
+    if (avx2)
+      batched_multiply_range_avx2<S>(batch, begin, end);
+    else
+      batched_multiply_range<S>(batch, begin, end);
+  }
+}
+
+// Multiplies `count` independent M x K by K x N products, parallelised across the batch.
+// Square 4, 8, 16 and 32 sizes go to the unrolled kernels; returns false when the
+// generic path was used
+template <class Batch>
+bool batched_multiply(const Batch &batch, int M, int N, int K, long count, int numThreads)
+{
+  if (M == N && N == K)
+  {
+    switch (M)
+    {
+    case 4:
+      batched_multiply_fixed<4>(batch, count, numThreads);
+      return true;
+    case 8:
+      batched_multiply_fixed<8>(batch, count, numThreads);
+      return true;
+    case 16:
+      batched_multiply_fixed<16>(batch, count, numThreads);
+      return true;
+    case 32:
+      batched_multiply_fixed<32>(batch, count, numThreads);
+      return true;
+    }
+  }
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (long b = 0; b < count; b++)
+  {
+    small_multiply_generic(batch.a(b), batch.b(b), batch.c(b), M, N, K);
+  }
+  return false;
+}
+
+#endif
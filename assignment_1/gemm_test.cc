@@ -0,0 +1,73 @@
+// Checks of the threaded dgemm: build with g++ -O3 -fopenmp gemm_test.cc && ./a.out
+// Exits non-zero on the first failing check.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "gemm.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, int M, int N, int threads)
+{
+  if (!ok)
+  {
+    std::printf("FAILED: %s (M=%d, N=%d, threads=%d)\n", what, M, N, threads);
+    failures++;
+  }
+}
+
+// Every thread of the grid must own a non-empty block of C, and the blocks must tile C
+// exactly, whenever C has at least as many MR x NR micro-tiles as the grid has cells
+// along each dimension
+static void check_thread_tiles(int M, int N, int threads)
+{
+  ThreadGrid grid = make_thread_grid(threads, M, N);
+  check(grid.rows * grid.cols == threads, "grid uses every thread", M, N, threads);
+  if (grid.rows > (M + MR - 1) / MR || grid.cols > (N + NR - 1) / NR)
+    return;
+
+  std::vector<int> owner((long)M * N, 0);
+  for (int t = 0; t < threads; t++)
+  {
+    int i0, i1, j0, j1;
+    thread_tile(grid, t, M, N, i0, i1, j0, j1);
+    check(i0 < i1 && j0 < j1, "every thread gets a non-empty tile", M, N, threads);
+    for (int i = i0; i < i1; i++)
+      for (int j = j0; j < j1; j++)
+        owner[(long)i * N + j]++;
+  }
+  bool exact = true;
+  for (int count : owner)
+    exact = exact && count == 1;
+  check(exact, "thread tiles cover C exactly once", M, N, threads);
+}
+
+// The threaded multiply must agree with the single-threaded one for a blocking whose nc is
+// wider than any one thread's column slice
+static void check_threaded_result(int M, int N, int K, int threads)
+{
+  std::vector<double> A((long)M * K), B((long)K * N), C1((long)M * N), Ct((long)M * N);
+  for (size_t i = 0; i < A.size(); i++)
+    A[i] = (double)((i * 7) % 13) - 6.0;
+  for (size_t i = 0; i < B.size(); i++)
+    B[i] = (double)((i * 5) % 11) - 5.0;
+  dgemm(NoTrans, NoTrans, M, N, K, 1.0, A.data(), K, B.data(), N, 0.0, C1.data(), N);
+  dgemm(NoTrans, NoTrans, M, N, K, 1.0, A.data(), K, B.data(), N, 0.0, Ct.data(), N, DEFAULT_BLOCKING, threads);
+  check(C1 == Ct, "threaded dgemm matches serial dgemm", M, N, threads);
+}
+
+int main()
+{
+  const int shapes[][2] = {{4096, 4096}, {1024, 4096}, {4096, 256}, {96, 2048}, {6, 4096}, {100, 100}};
+  for (auto &shape : shapes)
+    for (int threads = 1; threads <= 64; threads++)
+      check_thread_tiles(shape[0], shape[1], threads);
+
+  check_threaded_result(200, 300, 64, 16);
+  check_threaded_result(37, 1000, 50, 12);
+
+  if (failures == 0)
+    std::printf("All gemm checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
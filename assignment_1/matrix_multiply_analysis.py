@@ -7,7 +7,11 @@ def parse_output_file(filename):
         'M': [],
         'N': [],
         'K': [],
-        'MNK': []  # New category for varying M, N, K together
+        'MNK': [],  # New category for varying M, N, K together
+        'threads': [],  # Strong scaling of the parallel tiled multiply
+        'tuned': [],  # Autotuned mc/kc/nc blocking
+        'batched': [],  # Batched small products
+        'strassen': []  # Strassen-Winograd runs
     }
     current_params = None
     
@@ -16,12 +20,47 @@ def parse_output_file(filename):
             if line.startswith("Running with"):
                 params = re.findall(r'(\w+)=(\d+)', line)
                 current_params = {k: int(v) for k, v in params}
+                naive_time = None  # the naive reference only runs for smaller shapes
+            elif line.startswith("Running autotuned"):
+                params = re.findall(r'(\w+)=(\d+)', line)
+                current_params = {k: int(v) for k, v in params}
+                current_params['TUNED'] = True
+            elif line.startswith("Running batched"):
+                params = re.findall(r'(\w+)=(\d+)', line)
+                current_params = {k: int(v) for k, v in params}
+                current_params['BATCHED'] = True
+            elif line.startswith("Running strassen"):
+                params = re.findall(r'(\w+)=(\d+)', line)
+                current_params = {k: int(v) for k, v in params}
+                current_params['STRASSEN'] = True
+            elif line.startswith("Tiled GFLOP/s:"):
+                tiled_gflops = float(re.search(r'GFLOP/s: ([\d.]+)', line).group(1))
+                parallel_gflops = tiled_gflops  # replaced when a parallel run follows
+            elif line.startswith("Parallel GFLOP/s:"):
+                parallel_gflops = float(re.search(r'GFLOP/s: ([\d.]+)', line).group(1))
+            elif line.startswith("Strassen effective GFLOP/s:"):
+                strassen_gflops = float(re.search(r'GFLOP/s: ([\d.]+)', line).group(1))
+                # classical reference at the same thread count
+                results['strassen'].append((current_params['SIZE'], current_params['CROSSOVER'],
+                                            current_params.get('THREADS', 1), parallel_gflops, strassen_gflops))
+            elif line.startswith("Batched multiplication ("):
+                layout = re.search(r'\((\S+),', line).group(1)
+                rate = float(re.search(r'([\d.e+]+) matrices/s', line).group(1))
+                results['batched'].append((current_params['SIZE'], current_params['BATCH'], layout, rate))
             elif "Naive multiplication time:" in line:
                 naive_time = float(re.search(r'Naive multiplication time: ([\d.]+) seconds', line).group(1))
             elif "Tiled multiplication time:" in line:
                 tiled_time = float(re.search(r'Tiled multiplication time: ([\d.]+) seconds', line).group(1))
-                
-                if current_params['M'] == current_params['N'] == current_params['K'] == 1024:
+            elif "Parallel tiled multiplication time" in line:
+                parallel_time = float(re.search(r'\): ([\d.]+) seconds', line).group(1))
+                results['threads'].append((current_params['THREADS'], tiled_time, parallel_time))
+            elif line.startswith("-----"):
+                # the naive reference is printed after the tiled run, so classify once the run is complete
+                if current_params.get('BATCHED') or current_params.get('STRASSEN'):
+                    pass
+                elif current_params.get('TUNED'):
+                    results['tuned'].append((current_params['M'], current_params['N'], current_params['K'], tiled_time))
+                elif current_params['M'] == current_params['N'] == current_params['K'] == 1024:
                     results['tile_size'].append((current_params['TILE_SIZE'], naive_time, tiled_time))
                 elif current_params['N'] == current_params['K'] == 1024 and current_params['TILE_SIZE'] == 32:
                     results['M'].append((current_params['M'], naive_time, tiled_time))
@@ -101,3 +140,78 @@ plt.legend()
 plt.grid(True)
 plt.savefig('vary_MNK_performance.jpg')
 plt.close()
+
+# Graph 6: Strong scaling of the parallel tiled multiply for M=N=K=4096
+if results['threads']:
+    plt.figure(figsize=(12, 6))
+    thread_counts, serial_times, parallel_times = zip(*sorted(results['threads']))
+    speedups = [s / p for s, p in zip(serial_times, parallel_times)]
+    plt.plot(thread_counts, speedups, label='Parallel Tiled Multiply (tile size=128)', marker='o')
+    plt.plot(thread_counts, thread_counts, 'r--', label='Ideal')
+    plt.xlabel('Threads')
+    plt.ylabel('Speedup over serial tiled')
+    plt.title('Strong Scaling of Parallel Tiled Multiplication (M=N=K=4096)')
+    plt.legend()
+    plt.grid(True)
+    plt.savefig('strong_scaling_performance.jpg')
+    plt.close()
+
+# Graph 7: Autotuned blocking against the tile size=32 runs for the same shapes
+if results['tuned']:
+    tuned = {(m, n, k): t for m, n, k, t in results['tuned']}
+    experiments = [('M', lambda v: (v, 1024, 1024)), ('N', lambda v: (1024, v, 1024)),
+                   ('K', lambda v: (1024, 1024, v)), ('MNK', lambda v: (v, v, v))]
+    fig, axes = plt.subplots(1, 4, figsize=(20, 5))
+    for ax, (name, shape) in zip(axes, experiments):
+        points = [(v, tiled, tuned[shape(v)]) for v, _, tiled in sorted(results[name]) if shape(v) in tuned]
+        if not points:
+            continue
+        values, tiled_times, tuned_times = zip(*points)
+        ax.plot(values, tiled_times, label='Tile size=32', marker='x')
+        ax.plot(values, tuned_times, label='Autotuned mc/kc/nc', marker='o')
+        ax.set_xlabel(name)
+        ax.set_ylabel('Time (seconds)')
+        ax.legend()
+        ax.grid(True)
+    fig.suptitle('Autotuned Blocking vs. Single Tile Size')
+    plt.savefig('autotuned_performance.jpg')
+    plt.close()
+
+# Graph 8: Batched small products, matrices per second against batch size
+if results['batched']:
+    plt.figure(figsize=(12, 6))
+    for size in sorted({r[0] for r in results['batched']}):
+        for layout in ('strided', 'pointer-array'):
+            points = sorted((b, rate) for s, b, l, rate in results['batched'] if s == size and l == layout)
+            if points:
+                batches, rates = zip(*points)
+                plt.plot(batches, rates, label=f'{size}x{size} ({layout})', marker='o')
+    plt.xscale('log')
+    plt.yscale('log')
+    plt.xlabel('Batch Size')
+    plt.ylabel('Matrices per Second')
+    plt.title('Batched Small Matrix Multiplication Throughput')
+    plt.legend()
+    plt.grid(True)
+    plt.savefig('batched_performance.jpg')
+    plt.close()
+
+# Graph 9: Effective GFLOP/s of Strassen-Winograd against the classical kernel
+if results['strassen']:
+    plt.figure(figsize=(12, 6))
+    sizes = sorted({r[0] for r in results['strassen']})
+    for threads in sorted({r[2] for r in results['strassen']}):
+        classical = [max(r[3] for r in results['strassen'] if r[0] == size and r[2] == threads) for size in sizes]
+        plt.plot(sizes, classical, label=f'Classical tiled ({threads} threads)', marker='x')
+        for crossover in sorted({r[1] for r in results['strassen']}):
+            points = sorted((size, gflops) for size, c, t, _, gflops in results['strassen'] if c == crossover and t == threads)
+            if points:
+                xs, ys = zip(*points)
+                plt.plot(xs, ys, label=f'Strassen (crossover={crossover}, {threads} threads)', marker='o')
+    plt.xlabel('Matrix Size (M=N=K)')
+    plt.ylabel('Effective GFLOP/s (2n^3 / time)')
+    plt.title('Strassen-Winograd vs. Classical Multiplication')
+    plt.legend()
+    plt.grid(True)
+    plt.savefig('strassen_performance.jpg')
+    plt.close()
@@ -2,7 +2,7 @@
 #SBATCH --job-name=cs21b060_matrix_multiply
 #SBATCH --nodes=1               # Number of nodes
 #SBATCH --ntasks=1              # Number of tasks (processes)
-#SBATCH --cpus-per-task=1       # Number of CPUs per task
+#SBATCH --cpus-per-task=64      # Number of CPUs per task
 #SBATCH --partition=defq
 #SBATCH --time=59:00
 #SBATCH -o my_super_job.o
@@ -15,8 +15,26 @@ run_executable() {
     N=$2
     K=$3
     TILE_SIZE=$4
-    echo "Running with M=$M, N=$N, K=$K, TILE_SIZE=$TILE_SIZE"
-    ./a.out $M $N $K $TILE_SIZE
+    THREADS=${5:-1}
+    echo "Running with M=$M, N=$N, K=$K, TILE_SIZE=$TILE_SIZE, THREADS=$THREADS"
+    # the O(n^3) naive reference is only affordable up to 2048^3 flops;
+    # larger runs are checked by Freivalds verification alone
+    NAIVE=""
+    if [ $((M * N * K)) -le $((2048 * 2048 * 2048)) ]; then
+        NAIVE="-n"
+    fi
+    ./a.out $M $N $K -t $TILE_SIZE -p $THREADS $NAIVE
+    echo "----------------------------------------"
+}
+
+# Same as run_executable, but with mc/kc/nc autotuned per CPU and shape bucket;
+# the first run of a bucket searches and fills gemm_tuning.cache, later runs reuse it
+run_autotuned() {
+    M=$1
+    N=$2
+    K=$3
+    echo "Running autotuned with M=$M, N=$N, K=$K"
+    ./a.out $M $N $K -a
     echo "----------------------------------------"
 }
 
@@ -31,6 +49,11 @@ M_VALUES=(512 1024 2048 4096)
 N_VALUES=(512 1024 2048 4096)
 K_VALUES=(512 1024 2048 4096)
 TILE_SIZES=(32 64 128 256)
+THREAD_COUNTS=(1 2 4 8 16 32 64)
+
+# keep threads on separate cores so first-touch placement stays valid
+export OMP_PROC_BIND=spread
+export OMP_PLACES=cores
 
 
 # 1. Vary tile size for fixed M, N, K (M=N=K=1024)
@@ -57,3 +80,45 @@ done
 for SIZE in "${M_VALUES[@]}"; do
     run_executable $SIZE $SIZE $SIZE $TILE_SIZE_FIXED
 done
+
+# 6. Strong scaling of the parallel tiled multiply (M=N=K=4096, tile size=128)
+for THREADS in "${THREAD_COUNTS[@]}"; do
+    run_executable 4096 4096 4096 128 $THREADS
+done
+
+# 7. Autotuned blocking for the non-square and square shapes of experiments 2-5
+for SIZE in "${M_VALUES[@]}"; do
+    run_autotuned $SIZE $N_FIXED $K_FIXED
+    run_autotuned $M_FIXED $SIZE $K_FIXED
+    run_autotuned $M_FIXED $N_FIXED $SIZE
+    run_autotuned $SIZE $SIZE $SIZE
+done
+
+# 8. Batched small products: matrices/s for batch sizes 1e3..1e6
+# (combinations needing more than 4 GiB for A, B and C are skipped)
+BATCH_MATRIX_SIZES=(4 8 16 32)
+BATCH_COUNTS=(1000 10000 100000 1000000)
+for SIZE in "${BATCH_MATRIX_SIZES[@]}"; do
+    for COUNT in "${BATCH_COUNTS[@]}"; do
+        if [ $((3 * SIZE * SIZE * 8 * COUNT)) -le $((4 * 1024 * 1024 * 1024)) ]; then
+            echo "Running batched with SIZE=$SIZE, BATCH=$COUNT"
+            ./a.out $SIZE $SIZE $SIZE -B $COUNT -p 64
+            echo "----------------------------------------"
+        fi
+    done
+done
+
+# 9. Strassen-Winograd against the classical kernel for large square sizes,
+# serial and with the leaf products and additions on all cores
+STRASSEN_SIZES=(2048 4096)
+STRASSEN_CROSSOVERS=(256 512 1024)
+STRASSEN_THREADS=(1 64)
+for SIZE in "${STRASSEN_SIZES[@]}"; do
+    for CROSSOVER in "${STRASSEN_CROSSOVERS[@]}"; do
+        for THREADS in "${STRASSEN_THREADS[@]}"; do
+            echo "Running strassen with SIZE=$SIZE, CROSSOVER=$CROSSOVER, THREADS=$THREADS"
+            ./a.out $SIZE $SIZE $SIZE -s $CROSSOVER -p $THREADS
+            echo "----------------------------------------"
+        done
+    done
+done
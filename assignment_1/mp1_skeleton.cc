@@ -6,13 +6,43 @@
 #include <iomanip>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
+#include <omp.h>
+#include <cpuid.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "gemm.h"
 
-double *allocate_matrix(int rows, int cols)
+// Deterministic value in [0, 1] for element idx of matrix `seed`, independent of the thread that writes it
+double matrix_value(unsigned seed, long idx)
 {
-  double *matrix = (double *)_mm_malloc(rows * cols * sizeof(double), 32);
-  for (int i = 0; i < rows * cols; i++)
+  unsigned long long z = ((unsigned long long)seed << 40) + idx + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return static_cast<double>(z >> 11) / static_cast<double>(1ULL << 53);
+}
+
+// Allocates and fills a rows x cols matrix. Each thread of `grid` first-touches the
+// block of rowTile x colTile tiles it will later work on, so with a NUMA-aware OS the
+// pages land on the memory node of that thread.
+double *allocate_matrix(int rows, int cols, unsigned seed, ThreadGrid grid = {1, 1}, int rowTile = 1, int colTile = 1)
+{
+  double *matrix = (double *)_mm_malloc((long)rows * cols * sizeof(double), 32);
+#pragma omp parallel num_threads(grid.rows * grid.cols)
   {
-    matrix[i] = static_cast<double>(rand()) / RAND_MAX;
+    int t = omp_get_thread_num();
+    int i0, i1, j0, j1;
+    tile_range(rows, rowTile, grid.rows, t / grid.cols, i0, i1);
+    tile_range(cols, colTile, grid.cols, t % grid.cols, j0, j1);
+    for (int i = i0; i < i1; i++)
+    {
+      for (int j = j0; j < j1; j++)
+      {
+        matrix[(long)i * cols + j] = matrix_value(seed, (long)i * cols + j);
+      }
+    }
   }
   return matrix;
 }
@@ -32,94 +62,494 @@ void naive_multiply(double *A, double *B, double *C, int M, int N, int K)
   }
 }
 
-void tiled_multiply(double *A, double *B, double *C, int M, int N, int K, int tileSize)
+bool compare_matrices(double *C1, double *C2, int rows, int cols, double tolerance = 1e-9)
 {
-  // setting C to 0
-  memset(C, 0, M * N * sizeof(double));
+  for (int i = 0; i < rows * cols; ++i)
+  {
+    if (std::fabs(C1[i] - C2[i]) > tolerance)
+    {
+      return false;
+    }
+  }
+  return true;
+}
 
-  // Tiled multiplication
-  for (int ii = 0; ii < M; ii += tileSize)
+// Times batched_multiply for both layouts, repeating small batches until at least
+// half a second has elapsed, and checks a few products against naive_multiply
+void run_batch_benchmark(int M, int N, int K, long count, int numThreads)
+{
+  long sizeA = (long)M * K, sizeB = (long)K * N, sizeC = (long)M * N;
+  double *A = (double *)_mm_malloc(count * sizeA * sizeof(double), 64);
+  double *B = (double *)_mm_malloc(count * sizeB * sizeof(double), 64);
+  double *C = (double *)_mm_malloc(count * sizeC * sizeof(double), 64);
+  const double **Aptr = new const double *[count];
+  const double **Bptr = new const double *[count];
+  double **Cptr = new double *[count];
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (long b = 0; b < count; b++)
+  {
+    for (long i = 0; i < sizeA; i++)
+      A[b * sizeA + i] = matrix_value(1, b * sizeA + i);
+    for (long i = 0; i < sizeB; i++)
+      B[b * sizeB + i] = matrix_value(2, b * sizeB + i);
+    memset(C + b * sizeC, 0, sizeC * sizeof(double));
+    Aptr[b] = A + b * sizeA;
+    Bptr[b] = B + b * sizeB;
+    Cptr[b] = C + b * sizeC;
+  }
+
+  PointerArrayBatch pointers = {Aptr, Bptr, Cptr};
+  StridedBatch strided = {A, B, C, sizeA, sizeB, sizeC};
+  double *reference = (double *)_mm_malloc(sizeC * sizeof(double), 32);
+
+  for (int layout = 0; layout < 2; layout++)
   {
-    for (int jj = 0; jj < N; jj += tileSize)
+    bool specialised = false;
+    long reps = 0;
+    std::chrono::duration<double> elapsed(0);
+    auto start = std::chrono::high_resolution_clock::now();
+    do
     {
-      for (int kk = 0; kk < K; kk += tileSize)
-      {
+      specialised = layout == 0 ? batched_multiply(strided, M, N, K, count, numThreads)
+                                : batched_multiply(pointers, M, N, K, count, numThreads);
+      reps++;
+      elapsed = std::chrono::high_resolution_clock::now() - start;
+    } while (elapsed.count() < 0.5);
 
-        for (int i = ii; i < ii + tileSize && i < M; i++)
-        {
-          for (int j = jj; j < jj + tileSize && j < N; j++)
-          {
-            double sum = 0.0;
-            for (int k = kk; k < kk + tileSize && k < K; k++)
-            {
-              sum += A[i * K + k] * B[k * N + j];
-            }
-            C[i * N + j] += sum;
-          }
-        }
-      }
+    double seconds = elapsed.count() / reps;
+    std::cout << std::scientific << std::setprecision(3)
+              << "Batched multiplication (" << (layout == 0 ? "strided" : "pointer-array") << ", "
+              << M << "x" << N << "x" << K << ", batch " << count << ", "
+              << (specialised ? "unrolled" : "generic") << " kernel): " << seconds << " seconds, "
+              << count / seconds << " matrices/s, " << std::fixed << std::setprecision(2)
+              << 2.0 * M * N * K * count / seconds / 1e9 << " GFLOP/s" << std::endl;
+
+    bool correct = true;
+    long samples[] = {0, count / 2, count - 1};
+    for (long b : samples)
+    {
+      naive_multiply(A + b * sizeA, B + b * sizeB, reference, M, N, K);
+      correct = correct && compare_matrices(reference, C + b * sizeC, M, N);
     }
+    std::cout << "Batched multiplication results are " << (correct ? "correct." : "incorrect.") << std::endl;
   }
+
+  _mm_free(reference);
+  delete[] Aptr;
+  delete[] Bptr;
+  delete[] Cptr;
+  _mm_free(A);
+  _mm_free(B);
+  _mm_free(C);
 }
 
-bool compare_matrices(double *C1, double *C2, int rows, int cols, double tolerance = 1e-9)
+// CPU brand string from CPUID leaves 0x80000002..4, used to key the tuning cache
+std::string cpu_model()
 {
-  for (int i = 0; i < rows * cols; ++i)
+  unsigned int regs[12] = {};
+  for (unsigned int leaf = 0; leaf < 3; leaf++)
   {
-    if (std::fabs(C1[i] - C2[i]) > tolerance)
+    unsigned int *r = regs + 4 * leaf;
+    if (!__get_cpuid(0x80000002 + leaf, &r[0], &r[1], &r[2], &r[3]))
+      return "unknown";
+  }
+  std::string model(reinterpret_cast<char *>(regs), sizeof(regs));
+  model = model.substr(0, model.find('\0'));
+  size_t first = model.find_first_not_of(' ');
+  size_t last = model.find_last_not_of(' ');
+  return first == std::string::npos ? "unknown" : model.substr(first, last - first + 1);
+}
+
+// Problem sizes are bucketed to the next power of two so nearby shapes share a tuning entry
+int size_bucket(int x)
+{
+  int b = 1;
+  while (b < x)
+    b *= 2;
+  return b;
+}
+
+// Tuning cache: one tab-separated line per entry, "cpu model, M N K buckets, mc kc nc, GFLOP/s".
+// New entries are appended, so when a key appears more than once the last line wins.
+bool lookup_tuned_blocking(const char *cacheFile, const std::string &cpu, int M, int N, int K, Blocking &blk)
+{
+  std::ifstream in(cacheFile);
+  std::string line;
+  bool found = false;
+  while (std::getline(in, line))
+  {
+    std::istringstream fields(line);
+    std::string model, sizes, blocking;
+    if (!std::getline(fields, model, '\t') || !std::getline(fields, sizes, '\t') || !std::getline(fields, blocking, '\t'))
+      continue;
+    int Mb, Nb, Kb;
+    Blocking entry;
+    if (model != cpu || !(std::istringstream(sizes) >> Mb >> Nb >> Kb) ||
+        !(std::istringstream(blocking) >> entry.mc >> entry.kc >> entry.nc))
+      continue;
+    if (Mb == size_bucket(M) && Nb == size_bucket(N) && Kb == size_bucket(K))
     {
-      return false;
+      blk = entry;
+      found = true;
     }
   }
-  return true;
+  return found;
+}
+
+void store_tuned_blocking(const char *cacheFile, const std::string &cpu, int M, int N, int K, const Blocking &blk, double gflops)
+{
+  std::ofstream out(cacheFile, std::ios::app);
+  out << cpu << '\t' << size_bucket(M) << ' ' << size_bucket(N) << ' ' << size_bucket(K) << '\t'
+      << blk.mc << ' ' << blk.kc << ' ' << blk.nc << '\t' << gflops << '\n';
+}
+
+// GFLOP/s of the serial packed multiply for one blocking, best of two runs
+double time_blocking(double *A, double *B, double *C, int M, int N, int K, const Blocking &blk)
+{
+  double best = 0.0;
+  for (int rep = 0; rep < 2; rep++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    dgemm(NoTrans, NoTrans, M, N, K, 1.0, A, K, B, N, 0.0, C, N, blk);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    best = std::max(best, 2.0 * M * N * K / elapsed.count() / 1e9);
+  }
+  return best;
+}
+
+// Searches mc, kc and nc one at a time (kc first since it sizes the L1/L2 working set),
+// on the problem shape clipped to at most 1536 per dimension so the search stays cheap
+Blocking autotune_blocking(int M, int N, int K, double &bestGflops)
+{
+  static const int MC_CANDIDATES[] = {48, 72, 96, 144, 192, 288};
+  static const int KC_CANDIDATES[] = {128, 192, 256, 384, 512};
+  static const int NC_CANDIDATES[] = {512, 1024, 2048, 4096};
+
+  int Mt = std::min(M, 1536), Nt = std::min(N, 1536), Kt = std::min(K, 1536);
+  double *A = allocate_matrix(Mt, Kt, 11);
+  double *B = allocate_matrix(Kt, Nt, 12);
+  double *C = allocate_matrix(Mt, Nt, 13);
+
+  Blocking best = DEFAULT_BLOCKING;
+  bestGflops = time_blocking(A, B, C, Mt, Nt, Kt, best);
+
+  for (int kc : KC_CANDIDATES)
+  {
+    Blocking trial = {best.mc, kc, best.nc};
+    double gflops = time_blocking(A, B, C, Mt, Nt, Kt, trial);
+    if (gflops > bestGflops)
+    {
+      bestGflops = gflops;
+      best = trial;
+    }
+  }
+  for (int mc : MC_CANDIDATES)
+  {
+    Blocking trial = {mc, best.kc, best.nc};
+    double gflops = time_blocking(A, B, C, Mt, Nt, Kt, trial);
+    if (gflops > bestGflops)
+    {
+      bestGflops = gflops;
+      best = trial;
+    }
+  }
+  for (int nc : NC_CANDIDATES)
+  {
+    Blocking trial = {best.mc, best.kc, nc};
+    double gflops = time_blocking(A, B, C, Mt, Nt, Kt, trial);
+    if (gflops > bestGflops)
+    {
+      bestGflops = gflops;
+      best = trial;
+    }
+  }
+
+  _mm_free(A);
+  _mm_free(B);
+  _mm_free(C);
+  return best;
+}
+
+// Freivalds' check of C == A*B in O(n^2) per round: draw r in {-1,+1}^N and compare
+// A*(B*r) with C*r. A wrong C passes one round with probability at most 1/2, so it
+// survives all rounds with probability at most 2^-rounds. Rounding differences are
+// accepted when they stay within a K-proportional multiple of eps * (|A|*|B|*|r|)_i;
+// maxResidual returns the largest |A*B*r - C*r|_i relative to that scale.
+bool freivalds_verify(double *A, double *B, double *C, int M, int N, int K, int rounds,
+                      int numThreads, double &maxResidual)
+{
+  const double tolerance = 4.0 * (K + 2) * 1.11e-16;
+  double *r = (double *)_mm_malloc(N * sizeof(double), 32);
+  double *Br = (double *)_mm_malloc(K * sizeof(double), 32);
+  double *absBr = (double *)_mm_malloc(K * sizeof(double), 32);
+  bool passed = true;
+  maxResidual = 0.0;
+
+  // |B|*|r| is the same for every sign vector, so it is computed once
+#pragma omp parallel for num_threads(numThreads)
+  for (int k = 0; k < K; k++)
+  {
+    double sum = 0.0;
+    for (int j = 0; j < N; j++)
+      sum += std::fabs(B[k * N + j]);
+    absBr[k] = sum;
+  }
+
+  for (int round = 0; round < rounds; round++)
+  {
+    for (int j = 0; j < N; j++)
+      r[j] = matrix_value(1000 + round, j) < 0.5 ? -1.0 : 1.0;
+
+#pragma omp parallel for num_threads(numThreads)
+    for (int k = 0; k < K; k++)
+    {
+      double sum = 0.0;
+      for (int j = 0; j < N; j++)
+        sum += B[k * N + j] * r[j];
+      Br[k] = sum;
+    }
+
+#pragma omp parallel for num_threads(numThreads) reduction(max : maxResidual)
+    for (int i = 0; i < M; i++)
+    {
+      double ABr = 0.0, scale = 0.0, Cr = 0.0;
+      for (int k = 0; k < K; k++)
+      {
+        ABr += A[i * K + k] * Br[k];
+        scale += std::fabs(A[i * K + k]) * absBr[k];
+      }
+      for (int j = 0; j < N; j++)
+      {
+        Cr += C[i * N + j] * r[j];
+        scale += std::fabs(C[i * N + j]);
+      }
+      double residual = std::fabs(ABr - Cr) / (scale > 0.0 ? scale : 1.0);
+      maxResidual = std::max(maxResidual, residual);
+    }
+
+    if (maxResidual > tolerance)
+    {
+      passed = false;
+      break;
+    }
+  }
+
+  _mm_free(r);
+  _mm_free(Br);
+  _mm_free(absBr);
+  return passed;
+}
+
+void print_usage(const char *prog)
+{
+  std::cerr << "Usage: " << prog << " <M> <N> <K> [options]\n"
+            << "  -t <tile_size>       one cubic tile for all three loops\n"
+            << "  -b <mc> <kc> <nc>    separate L2/L1/L3 blocking\n"
+            << "  -a                   autotune the blocking (cached per CPU and shape)\n"
+            << "  -c <file>            tuning cache file (default gemm_tuning.cache)\n"
+            << "  -p <num_threads>     also run the parallel tiled multiply\n"
+            << "  -v <rounds>          Freivalds verification rounds (default 10, 0 disables)\n"
+            << "  -n                   also run the O(n^3) naive reference and compare against it\n"
+            << "  -B <batch_count>     benchmark batched small M x N x K products instead\n"
+            << "  -s <crossover>       also run Strassen-Winograd above the crossover size" << std::endl;
 }
 
 int main(int argc, char *argv[])
 {
-  if (argc != 5)
+  if (argc < 4)
   {
-    std::cerr << "Usage: " << argv[0] << " <M> <N> <K> <tile_size>" << std::endl;
+    print_usage(argv[0]);
     return 1;
   }
 
   int M = std::atoi(argv[1]);
   int N = std::atoi(argv[2]);
   int K = std::atoi(argv[3]);
-  int tileSize = std::atoi(argv[4]);
+  int numThreads = 1;
+  int verifyRounds = 10;
+  bool runNaive = false;
+  long batchCount = 0;
+  int strassenCrossover = 0;
+  bool autotune = false;
+  const char *cacheFile = "gemm_tuning.cache";
+  Blocking blk = DEFAULT_BLOCKING;
+
+  for (int i = 4; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "-t" && i + 1 < argc)
+      blk = cubic_blocking(std::atoi(argv[++i]));
+    else if (arg == "-b" && i + 3 < argc)
+    {
+      blk.mc = round_up(std::atoi(argv[++i]), MR);
+      blk.kc = std::atoi(argv[++i]);
+      blk.nc = round_up(std::atoi(argv[++i]), NR);
+    }
+    else if (arg == "-a")
+      autotune = true;
+    else if (arg == "-c" && i + 1 < argc)
+      cacheFile = argv[++i];
+    else if (arg == "-p" && i + 1 < argc)
+      numThreads = std::atoi(argv[++i]);
+    else if (arg == "-v" && i + 1 < argc)
+      verifyRounds = std::atoi(argv[++i]);
+    else if (arg == "-n")
+      runNaive = true;
+    else if (arg == "-B" && i + 1 < argc)
+      batchCount = std::atol(argv[++i]);
+    else if (arg == "-s" && i + 1 < argc)
+      strassenCrossover = std::atoi(argv[++i]);
+    else
+    {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
 
-  double *A = allocate_matrix(M, K);
-  double *B = allocate_matrix(K, N);
-  double *C_naive = allocate_matrix(M, N);
-  double *C_tiled = allocate_matrix(M, N);
+  if (batchCount > 0)
+  {
+    run_batch_benchmark(M, N, K, batchCount, numThreads);
+    return 0;
+  }
+
+  if (autotune)
+  {
+    std::string cpu = cpu_model();
+    if (lookup_tuned_blocking(cacheFile, cpu, M, N, K, blk))
+    {
+      std::cout << "Using cached blocking for " << cpu << std::endl;
+    }
+    else
+    {
+      double gflops;
+      auto start = std::chrono::high_resolution_clock::now();
+      blk = autotune_blocking(M, N, K, gflops);
+      auto end = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> tune_time = end - start;
+      store_tuned_blocking(cacheFile, cpu, M, N, K, blk, gflops);
+      std::cout << std::fixed << std::setprecision(2)
+                << "Autotuning time: " << tune_time.count() << " seconds (" << gflops << " GFLOP/s on the search shape)" << std::endl;
+    }
+  }
+  std::cout << "Blocking: mc=" << blk.mc << " kc=" << blk.kc << " nc=" << blk.nc << std::endl;
+
+  // initialise with the thread layout of the parallel multiply for first-touch placement
+  ThreadGrid grid = make_thread_grid(numThreads, M, N);
+  double *A = allocate_matrix(M, K, 1, grid, MR, blk.kc);
+  double *B = allocate_matrix(K, N, 2, grid, blk.kc, NR);
+  double *C_tiled = allocate_matrix(M, N, 4, grid, MR, NR);
 
   auto start = std::chrono::high_resolution_clock::now();
-  naive_multiply(A, B, C_naive, M, N, K);
+  dgemm(NoTrans, NoTrans, M, N, K, 1.0, A, K, B, N, 0.0, C_tiled, N, blk);
   auto end = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> naive_time = end - start;
-  std::cout << std::fixed << std::setprecision(2)
-            << "Naive multiplication time: " << naive_time.count() << " seconds" << std::endl;
-
-  start = std::chrono::high_resolution_clock::now();
-  tiled_multiply(A, B, C_tiled, M, N, K, tileSize);
-  end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> tiled_time = end - start;
   std::cout << std::fixed << std::setprecision(2)
             << "Tiled multiplication time: " << tiled_time.count() << " seconds" << std::endl;
+  std::cout << "Tiled GFLOP/s: " << 2.0 * M * N * K / tiled_time.count() / 1e9
+            << " (" << micro_kernel_name(select_micro_kernel()) << " micro-kernel)" << std::endl;
 
-  bool correct = compare_matrices(C_naive, C_tiled, M, N);
+  if (verifyRounds > 0)
+  {
+    double maxResidual;
+    start = std::chrono::high_resolution_clock::now();
+    bool passed = freivalds_verify(A, B, C_tiled, M, N, K, verifyRounds, numThreads, maxResidual);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> verify_time = end - start;
+    std::cout << std::fixed << std::setprecision(2)
+              << "Freivalds verification time: " << verify_time.count() << " seconds" << std::endl;
+    std::cout << std::scientific << std::setprecision(2)
+              << "Freivalds verification " << (passed ? "passed" : "FAILED") << " (" << verifyRounds
+              << " rounds, max scaled residual " << maxResidual << ", false-acceptance probability <= "
+              << std::ldexp(1.0, -verifyRounds) << ")" << std::endl;
+  }
 
-  if (correct)
+  if (runNaive)
   {
-    std::cout << "Multiplication results are correct." << std::endl;
+    double *C_naive = allocate_matrix(M, N, 3, grid, MR, NR);
+
+    start = std::chrono::high_resolution_clock::now();
+    naive_multiply(A, B, C_naive, M, N, K);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> naive_time = end - start;
+    std::cout << std::fixed << std::setprecision(2)
+              << "Naive multiplication time: " << naive_time.count() << " seconds" << std::endl;
+
+    bool correct = compare_matrices(C_naive, C_tiled, M, N);
+
+    if (correct)
+    {
+      std::cout << "Multiplication results are correct." << std::endl;
+    }
+    else
+    {
+      std::cout << "Multiplication results are incorrect." << std::endl;
+    }
+    _mm_free(C_naive);
   }
-  else
+
+  double parallelSeconds = 0.0;
+  if (numThreads > 1)
   {
-    std::cout << "Multiplication results are incorrect." << std::endl;
+    double *C_parallel = allocate_matrix(M, N, 5, grid, MR, NR);
+
+    start = std::chrono::high_resolution_clock::now();
+    dgemm(NoTrans, NoTrans, M, N, K, 1.0, A, K, B, N, 0.0, C_parallel, N, blk, numThreads);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> parallel_time = end - start;
+    parallelSeconds = parallel_time.count();
+    std::cout << std::fixed << std::setprecision(2)
+              << "Parallel tiled multiplication time (" << numThreads << " threads, "
+              << grid.rows << "x" << grid.cols << " grid): " << parallel_time.count() << " seconds" << std::endl;
+    std::cout << "Parallel GFLOP/s: " << 2.0 * M * N * K / parallel_time.count() / 1e9
+              << ", speedup over serial tiled: " << tiled_time.count() / parallel_time.count() << std::endl;
+
+    // every C element sees the same K blocking as the serial run, so the results agree exactly
+    if (compare_matrices(C_tiled, C_parallel, M, N, 0.0))
+    {
+      std::cout << "Parallel multiplication results are correct." << std::endl;
+    }
+    else
+    {
+      std::cout << "Parallel multiplication results are incorrect." << std::endl;
+    }
+    _mm_free(C_parallel);
+  }
+
+  if (strassenCrossover > 0)
+  {
+    double *C_strassen = allocate_matrix(M, N, 6, grid, MR, NR);
+    long arenaBytes;
+
+    start = std::chrono::high_resolution_clock::now();
+    strassen_multiply(M, N, K, A, K, B, N, C_strassen, N, strassenCrossover, blk, numThreads, &arenaBytes);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> strassen_time = end - start;
+    std::cout << std::fixed << std::setprecision(2)
+              << "Strassen multiplication time (crossover " << strassenCrossover << ", "
+              << strassen_levels(M, N, K, strassenCrossover) << " levels, arena " << arenaBytes / (1024.0 * 1024.0)
+              << " MB): " << strassen_time.count() << " seconds" << std::endl;
+    // effective rate counts the classical 2MNK flops, so it is directly comparable with the tiled one
+    std::cout << "Strassen effective GFLOP/s: " << 2.0 * M * N * K / strassen_time.count() / 1e9
+              << ", speedup over serial tiled: " << tiled_time.count() / strassen_time.count();
+    if (numThreads > 1)
+      std::cout << ", over parallel tiled (" << numThreads << " threads): " << parallelSeconds / strassen_time.count();
+    std::cout << std::endl;
+
+    double maxError = 0.0, maxValue = 0.0;
+    for (long i = 0; i < (long)M * N; i++)
+    {
+      maxError = std::max(maxError, std::fabs(C_strassen[i] - C_tiled[i]));
+      maxValue = std::max(maxValue, std::fabs(C_tiled[i]));
+    }
+    std::cout << std::scientific << std::setprecision(2)
+              << "Strassen max error vs classical: " << maxError << " (relative " << maxError / maxValue << ")" << std::endl;
+    _mm_free(C_strassen);
   }
 
   _mm_free(A);
   _mm_free(B);
-  _mm_free(C_naive);
   _mm_free(C_tiled);
 
   return 0;
@@ -5,19 +5,230 @@
 #include <chrono>
 #include <thread>
 #include <omp.h>
+#include <immintrin.h>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <complex>
+#include <condition_variable>
+#include <sstream>
+#include <cstdlib>
+#include <zlib.h>  // PNG output: build with g++ -O3 -fopenmp mandelbrot.cc -lz
 
 struct RGB {
   unsigned char r, g, b;
 };
 
-void writeImage(const char* filename, int width, int height, const std::vector<RGB>& image) 
+static_assert(sizeof(RGB) == 3, "image rows are written as packed RGB bytes");
+
+enum ImageFormat { FORMAT_AUTO, FORMAT_PNG, FORMAT_PPM };
+ImageFormat imageFormat = FORMAT_AUTO;
+
+void appendBigEndian32(std::vector<unsigned char>& out, unsigned long value) 
+{
+  out.push_back((value >> 24) & 0xFF);
+  out.push_back((value >> 16) & 0xFF);
+  out.push_back((value >> 8) & 0xFF);
+  out.push_back(value & 0xFF);
+}
+
+void appendPNGChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t length) 
+{
+  appendBigEndian32(out, length);
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + length);
+  appendBigEndian32(out, crc32(0L, out.data() + start, out.size() - start));
+}
+
+int paethPredictor(int a, int b, int c) 
+{
+  int p = a + b - c;
+  int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+// Writes the residuals of one PNG filter into out and returns their sum of absolute values.
+// Instantiated once per filter, so each gets its own loop; the first pixel, whose left
+// neighbours a and c are zero, is split off so the main loop has no branches.
+template <typename Predictor>
+long filterResiduals(const unsigned char* row, const unsigned char* prev, int length, unsigned char* out, Predictor predict) 
+{
+  const int bpp = 3;
+  long cost = 0;
+  for (int i = 0; i < std::min(bpp, length); ++i) {
+    out[i] = static_cast<unsigned char>(row[i] - predict(0, prev[i], 0));
+    cost += std::abs(static_cast<signed char>(out[i]));
+  }
+  for (int i = bpp; i < length; ++i) {
+    out[i] = static_cast<unsigned char>(row[i] - predict(row[i - bpp], prev[i], prev[i - bpp]));
+    cost += std::abs(static_cast<signed char>(out[i]));
+  }
+  return cost;
+}
+
+// Writes the filter type byte and filtered bytes of one scanline into out, picking the
+// PNG filter with the smallest sum of absolute residuals (the usual libpng heuristic).
+// prev is a row of zeros for the first scanline; scratch holds length bytes and belongs
+// to the caller, so it is allocated once per strip rather than per row and filter.
+void filterScanline(const unsigned char* row, const unsigned char* prev, int length, unsigned char* out, unsigned char* scratch) 
+{
+  out[0] = 0;
+  long bestCost = filterResiduals(row, prev, length, out + 1, [](int, int, int) { return 0; });
+  auto consider = [&](unsigned char filter, long cost) {
+    if (cost < bestCost) {
+      bestCost = cost;
+      out[0] = filter;
+      std::copy(scratch, scratch + length, out + 1);
+    }
+  };
+  consider(1, filterResiduals(row, prev, length, scratch, [](int a, int, int) { return a; }));
+  consider(2, filterResiduals(row, prev, length, scratch, [](int, int b, int) { return b; }));
+  consider(3, filterResiduals(row, prev, length, scratch, [](int a, int b, int) { return (a + b) / 2; }));
+  consider(4, filterResiduals(row, prev, length, scratch, paethPredictor));
+}
+
+// PNG encoder: scanlines are filtered in parallel, then cut into horizontal strips that
+// are deflated independently (each primed with the previous 32 KiB as dictionary) and
+// ended with a sync flush, so the raw deflate outputs concatenate into one valid stream;
+// the per-strip Adler-32 sums are merged with adler32_combine for the zlib trailer
+std::vector<unsigned char> encodePNG(int width, int height, const std::vector<RGB>& image) 
+{
+  const size_t rowBytes = static_cast<size_t>(width) * 3;
+  const size_t lineBytes = rowBytes + 1;
+  const unsigned char* pixels = reinterpret_cast<const unsigned char*>(image.data());
+  std::vector<unsigned char> filtered(lineBytes * height);
+
+  const std::vector<unsigned char> zeroRow(rowBytes, 0);
+  #pragma omp parallel
+  {
+    std::vector<unsigned char> scratch(rowBytes);  // reused for every row of this thread's strip
+    #pragma omp for schedule(static)
+    for (int j = 0; j < height; ++j) {
+      const unsigned char* prev = j > 0 ? pixels + (j - 1) * rowBytes : zeroRow.data();
+      filterScanline(pixels + j * rowBytes, prev, rowBytes, filtered.data() + j * lineBytes, scratch.data());
+    }
+  }
+
+  int numStrips = std::max(1, std::min(height / 16, omp_get_max_threads() * 4));
+  std::vector<std::vector<unsigned char>> strips(numStrips);
+  std::vector<unsigned long> adlers(numStrips);
+  std::vector<size_t> stripStart(numStrips + 1);
+  std::vector<int> stripError(numStrips, Z_OK);
+  for (int s = 0; s <= numStrips; ++s) stripStart[s] = lineBytes * (static_cast<size_t>(height) * s / numStrips);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int s = 0; s < numStrips; ++s) {
+    const unsigned char* data = filtered.data() + stripStart[s];
+    size_t length = stripStart[s + 1] - stripStart[s];
+    bool last = s == numStrips - 1;
+    z_stream stream = {};
+    int status = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    if (status != Z_OK) {
+      stripError[s] = status;
+      continue;
+    }
+    if (s > 0) {
+      size_t dictionary = std::min<size_t>(32768, stripStart[s]);
+      status = deflateSetDictionary(&stream, data - dictionary, dictionary);
+    }
+    if (status == Z_OK) {
+      strips[s].resize(deflateBound(&stream, length) + 16);
+      stream.next_in = const_cast<unsigned char*>(data);
+      stream.avail_in = length;
+      stream.next_out = strips[s].data();
+      stream.avail_out = strips[s].size();
+      status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+      // a sync flush is only complete when it left output space unused
+      bool complete = last ? status == Z_STREAM_END : (status == Z_OK && stream.avail_out > 0);
+      if (complete) status = Z_OK;
+      else if (status >= Z_OK) status = Z_BUF_ERROR;
+      strips[s].resize(stream.total_out);
+    }
+    deflateEnd(&stream);
+    stripError[s] = status;
+    adlers[s] = adler32(1L, data, length);
+  }
+  for (int s = 0; s < numStrips; ++s) {
+    if (stripError[s] != Z_OK) {
+      std::cerr << "PNG compression failed on strip " << s << " of " << numStrips << ": " << zError(stripError[s]) << "\n";
+      std::exit(1);
+    }
+  }
+
+  std::vector<unsigned char> zlibStream = {0x78, 0x9C};
+  unsigned long adler = adlers[0];
+  for (int s = 0; s < numStrips; ++s) {
+    zlibStream.insert(zlibStream.end(), strips[s].begin(), strips[s].end());
+    if (s > 0) adler = adler32_combine(adler, adlers[s], stripStart[s + 1] - stripStart[s]);
+  }
+  appendBigEndian32(zlibStream, adler);
+
+  std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  std::vector<unsigned char> header;
+  appendBigEndian32(header, width);
+  appendBigEndian32(header, height);
+  header.insert(header.end(), {8, 2, 0, 0, 0});  // 8-bit RGB, deflate, adaptive filtering, no interlace
+  appendPNGChunk(png, "IHDR", header.data(), header.size());
+  const size_t maxChunk = 1u << 30;
+  for (size_t offset = 0; offset < zlibStream.size(); offset += maxChunk)
+    appendPNGChunk(png, "IDAT", zlibStream.data() + offset, std::min(maxChunk, zlibStream.size() - offset));
+  appendPNGChunk(png, "IEND", nullptr, 0);
+  return png;
+}
+
+std::vector<unsigned char> encodePPM(int width, int height, const std::vector<RGB>& image) 
+{
+  std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+  std::vector<unsigned char> ppm(header.begin(), header.end());
+  const unsigned char* pixels = reinterpret_cast<const unsigned char*>(image.data());
+  ppm.insert(ppm.end(), pixels, pixels + image.size() * 3);
+  return ppm;
+}
+
+// The format follows -f, or the file extension (.ppm) when not given; PNG otherwise
+bool writesPPM(const char* filename) 
+{
+  std::string name = filename;
+  return imageFormat == FORMAT_PPM || (imageFormat == FORMAT_AUTO && name.size() >= 4 && name.compare(name.size() - 4, 4, ".ppm") == 0);
+}
+
+// Writes the encoded image, stopping with a message when the file cannot be opened or
+// fully written (bad path, full disk) rather than leaving a missing or short image
+void writeFile(const char* filename, const std::vector<unsigned char>& bytes) 
 {
   std::ofstream ofs(filename, std::ios::out | std::ios::binary);
-  ofs << "P6" << "\n" << width << " " << height << "\n255\n";
-  for (int i = 0; i < width * height; ++i) {
-    ofs << image[i].r << image[i].g << image[i].b;
+  if (!ofs) {
+    std::cerr << "Cannot open " << filename << " for writing\n";
+    std::exit(1);
   }
+  ofs.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
   ofs.close();
+  if (!ofs) {
+    std::cerr << "Failed writing " << bytes.size() << " bytes to " << filename << "\n";
+    std::exit(1);
+  }
+}
+
+// Encodes the whole file in memory and hands it to the OS in one write
+void writeImage(const char* filename, int width, int height, const std::vector<RGB>& image) 
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  bool ppm = writesPPM(filename);
+  std::vector<unsigned char> encoded = ppm ? encodePPM(width, height, image) : encodePNG(width, height, image);
+  auto encoded_at = std::chrono::high_resolution_clock::now();
+  writeFile(filename, encoded);
+  auto end = std::chrono::high_resolution_clock::now();
+
+  std::chrono::duration<double> encodeTime = encoded_at - start, writeTime = end - encoded_at;
+  std::cout << "Encoded " << filename << " as " << (ppm ? "PPM" : "PNG") << " (" << encoded.size() / (1024.0 * 1024.0) << " MB) in "
+            << encodeTime.count() << " seconds, write " << writeTime.count() << " seconds\n";
 }
 
 RGB getColor(int iterations, int maxIterations) 
@@ -29,7 +240,7 @@ RGB getColor(int iterations, int maxIterations)
   return {static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b)};
 }
 
-int mandelbrot(double x0, double y0, int maxIterations) 
+__attribute__((optimize("fp-contract=off"))) int mandelbrot(double x0, double y0, int maxIterations) 
 {
   double x = 0.0, y = 0.0;
   int iterations = 0;
@@ -42,36 +253,638 @@ int mandelbrot(double x0, double y0, int maxIterations)
   return iterations;
 }
 
+// Escape-time kernels over a span of pixels sharing one row: iterations[i] gets the
+// count for (x0s[i], y0). All of them evaluate exactly the same operations in the same
+// order as mandelbrot(), and fp-contract is off for all of them so no build flags
+// (-march=native, AVX-512F) can fuse a mul/add pair into FMA: the counts are bit-identical.
+typedef void (*MandelbrotSpanKernel)(const double* x0s, double y0, int count, int maxIterations, int* iterations);
+
+void mandelbrotSpanScalar(const double* x0s, double y0, int count, int maxIterations, int* iterations) 
+{
+  for (int i = 0; i < count; ++i) iterations[i] = mandelbrot(x0s[i], y0, maxIterations);
+}
+
+// 4 pixels per __m256d; a lane leaves the active mask for good once it escapes and the
+// vector exits as soon as every lane is done
+__attribute__((target("avx2"), optimize("fp-contract=off"))) void mandelbrotSpanAVX2(const double* x0s, double y0, int count, int maxIterations, int* iterations) 
+{
+  const __m256d four = _mm256_set1_pd(4.0), two = _mm256_set1_pd(2.0), one = _mm256_set1_pd(1.0);
+  const __m256d cy = _mm256_set1_pd(y0);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256d cx = _mm256_loadu_pd(x0s + i);
+    __m256d x = _mm256_setzero_pd(), y = _mm256_setzero_pd(), iters = _mm256_setzero_pd();
+    __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (int k = 0; k < maxIterations; ++k) {
+      __m256d xx = _mm256_mul_pd(x, x), yy = _mm256_mul_pd(y, y);
+      active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_add_pd(xx, yy), four, _CMP_LE_OQ));
+      if (_mm256_movemask_pd(active) == 0) break;
+      iters = _mm256_add_pd(iters, _mm256_and_pd(active, one));
+      __m256d xtemp = _mm256_add_pd(_mm256_sub_pd(xx, yy), cx);
+      y = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, x), y), cy);
+      x = xtemp;
+    }
+    _mm_storeu_si128((__m128i*)(iterations + i), _mm256_cvtpd_epi32(iters));
+  }
+  mandelbrotSpanScalar(x0s + i, y0, count - i, maxIterations, iterations + i);
+}
+
+// 8 pixels per __m512d with the active lanes kept in a k-mask
+__attribute__((target("avx512f"), optimize("fp-contract=off"))) void mandelbrotSpanAVX512(const double* x0s, double y0, int count, int maxIterations, int* iterations) 
+{
+  const __m512d four = _mm512_set1_pd(4.0), two = _mm512_set1_pd(2.0), one = _mm512_set1_pd(1.0);
+  const __m512d cy = _mm512_set1_pd(y0);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m512d cx = _mm512_loadu_pd(x0s + i);
+    __m512d x = _mm512_setzero_pd(), y = _mm512_setzero_pd(), iters = _mm512_setzero_pd();
+    __mmask8 active = 0xFF;
+    for (int k = 0; k < maxIterations; ++k) {
+      __m512d xx = _mm512_mul_pd(x, x), yy = _mm512_mul_pd(y, y);
+      active = _mm512_mask_cmp_pd_mask(active, _mm512_add_pd(xx, yy), four, _CMP_LE_OQ);
+      if (active == 0) break;
+      iters = _mm512_mask_add_pd(iters, active, iters, one);
+      __m512d xtemp = _mm512_add_pd(_mm512_sub_pd(xx, yy), cx);
+      y = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, x), y), cy);
+      x = xtemp;
+    }
+    _mm256_storeu_si256((__m256i*)(iterations + i), _mm512_mask_cvtpd_epi32(_mm256_setzero_si256(), 0xFF, iters));
+  }
+  mandelbrotSpanScalar(x0s + i, y0, count - i, maxIterations, iterations + i);
+}
+
+// Picks the widest kernel the CPU supports (CPUID), unless one is forced by name
+MandelbrotSpanKernel selectMandelbrotKernel(const std::string& name) 
+{
+  __builtin_cpu_init();
+  bool avx512 = __builtin_cpu_supports("avx512f"), avx2 = __builtin_cpu_supports("avx2");
+  if (name == "scalar") return mandelbrotSpanScalar;
+  if (name == "avx2" && avx2) return mandelbrotSpanAVX2;
+  if (name == "avx512" && avx512) return mandelbrotSpanAVX512;
+  if (name == "auto" && avx512) return mandelbrotSpanAVX512;
+  if (name == "auto" && avx2) return mandelbrotSpanAVX2;
+  if (name != "auto") std::cerr << "Kernel " << name << " is not available, using the widest supported one\n";
+  return avx512 ? mandelbrotSpanAVX512 : avx2 ? mandelbrotSpanAVX2 : mandelbrotSpanScalar;
+}
+
+const char* mandelbrotKernelName(MandelbrotSpanKernel kernel) 
+{
+  if (kernel == mandelbrotSpanAVX512) return "avx512";
+  if (kernel == mandelbrotSpanAVX2) return "avx2";
+  return "scalar";
+}
+
+MandelbrotSpanKernel spanKernel = mandelbrotSpanScalar;
+
+// Window of the complex plane that gets rendered: a square of side `scale` centred on
+// (centerX, centerY), stretched over the image. The default is the old [-2,2]x[-2,2].
+struct Viewport {
+  double centerX = 0.0, centerY = 0.0;
+  double scale = 4.0;
+};
+
+Viewport view;
+
+// x0 of every column; it only depends on the column, so rows share it
+std::vector<double> columnCoordinates(int width) 
+{
+  std::vector<double> x0s(width);
+  for (int i = 0; i < width; ++i) x0s[i] = view.centerX + (i - width / 2.0) * view.scale / width;
+  return x0s;
+}
+
+double rowCoordinate(int j, int height) 
+{
+  return view.centerY + (j - height / 2.0) * view.scale / height;
+}
+
+// Deep-zoom mode (-D). Past a scale of about 1e-13 neighbouring pixels round to the same
+// double, so one reference orbit is iterated in double-double (about 32 digits) and every
+// pixel only iterates its small offset from it in double (perturbation theory):
+//   delta_{n+1} = 2 Z_n delta_n + delta_n^2 + dc
+bool deepZoom = false;
+bool seriesApproximation = false;
+
+struct DoubleDouble {
+  double hi, lo;
+};
+
+DoubleDouble twoSum(double a, double b) 
+{
+  double s = a + b, v = s - a;
+  return {s, (a - (s - v)) + (b - v)};
+}
+
+DoubleDouble quickTwoSum(double a, double b) 
+{
+  double s = a + b;
+  return {s, b - (s - a)};
+}
+
+DoubleDouble ddAdd(DoubleDouble a, DoubleDouble b) 
+{
+  DoubleDouble s = twoSum(a.hi, b.hi), t = twoSum(a.lo, b.lo);
+  s = quickTwoSum(s.hi, s.lo + t.hi);
+  return quickTwoSum(s.hi, s.lo + t.lo);
+}
+
+DoubleDouble ddMul(DoubleDouble a, DoubleDouble b) 
+{
+  double p = a.hi * b.hi;
+  double e = std::fma(a.hi, b.hi, -p) + (a.hi * b.lo + a.lo * b.hi);
+  return quickTwoSum(p, e);
+}
+
+DoubleDouble ddDiv(DoubleDouble a, double b) 
+{
+  double q1 = a.hi / b;
+  DoubleDouble r = ddAdd(a, {-q1 * b, -std::fma(q1, b, -q1 * b)});
+  return quickTwoSum(q1, r.hi / b);
+}
+
+// Decimal text to double-double, so a centre like -0.74364388703715870475219150 keeps
+// the digits strtod would drop
+DoubleDouble parseDoubleDouble(const char* text) 
+{
+  DoubleDouble value = {0.0, 0.0};
+  bool negative = *text == '-';
+  if (*text == '-' || *text == '+') ++text;
+  int exponent = 0;
+  bool fraction = false;
+  for (; *text; ++text) {
+    if (*text == '.') fraction = true;
+    else if (*text >= '0' && *text <= '9') {
+      value = ddAdd(ddMul(value, {10.0, 0.0}), {static_cast<double>(*text - '0'), 0.0});
+      if (fraction) exponent--;
+    } else if (*text == 'e' || *text == 'E') {
+      exponent += std::atoi(text + 1);
+      break;
+    }
+  }
+  for (; exponent > 0; --exponent) value = ddMul(value, {10.0, 0.0});
+  for (; exponent < 0; ++exponent) value = ddDiv(value, 10.0);
+  return negative ? DoubleDouble{-value.hi, -value.lo} : value;
+}
+
+DoubleDouble deepCenterX = {0.0, 0.0}, deepCenterY = {0.0, 0.0};
+
+struct ReferenceOrbit {
+  double offsetX = 0.0, offsetY = 0.0;  // reference point minus the viewport centre
+  std::vector<double> zx, zy;           // Z_0 .. Z_last, rounded to double
+  std::vector<double> glitchLimit;      // 1e-6 |Z_n|^2, Pauldelbrot's glitch criterion
+  int skip = 0;                         // iterations covered by the series approximation
+  double ax = 0.0, ay = 0.0, bx = 0.0, by = 0.0, cx = 0.0, cy = 0.0;
+};
+
+struct DeepZoomStats {
+  int referenceLength = 0;
+  int glitched = 0;
+  int secondaryReferences = 0;
+  int unresolved = 0;
+};
+
+const int MAX_SECONDARY_REFERENCES = 64;
+
+ReferenceOrbit primaryOrbit;
+std::vector<unsigned char> glitched;
+DeepZoomStats deepStats;
+
+ReferenceOrbit computeReferenceOrbit(double offsetX, double offsetY, int maxIterations) 
+{
+  ReferenceOrbit orbit;
+  orbit.offsetX = offsetX;
+  orbit.offsetY = offsetY;
+  DoubleDouble cx = ddAdd(deepCenterX, {offsetX, 0.0}), cy = ddAdd(deepCenterY, {offsetY, 0.0});
+  DoubleDouble x = {0.0, 0.0}, y = {0.0, 0.0};
+  for (int n = 0; ; ++n) {
+    orbit.zx.push_back(x.hi);
+    orbit.zy.push_back(y.hi);
+    orbit.glitchLimit.push_back(1e-6 * (x.hi * x.hi + y.hi * y.hi));
+    if (x.hi * x.hi + y.hi * y.hi > 4.0 || n == maxIterations) break;
+    DoubleDouble xx = ddMul(x, x), yy = ddMul(y, y), xy = ddMul(x, y);
+    x = ddAdd(ddAdd(xx, {-yy.hi, -yy.lo}), cx);
+    y = ddAdd(ddAdd(xy, xy), cy);
+  }
+  return orbit;
+}
+
+// Fits delta_n ~ A dc + B dc^2 + C dc^3 along the orbit and keeps the largest n at which
+// the series still agrees with directly perturbed probes at the four image corners
+void fitSeriesApproximation(ReferenceOrbit& orbit, double halfWidth, double halfHeight) 
+{
+  typedef std::complex<double> Complex;
+  const double tolerance = 1e-12;
+  Complex a(0.0, 0.0), b(0.0, 0.0), c(0.0, 0.0);
+  Complex dc[4] = {{-halfWidth, -halfHeight}, {halfWidth, -halfHeight}, {-halfWidth, halfHeight}, {halfWidth, halfHeight}};
+  Complex delta[4];
+  int last = orbit.zx.size() - 1;
+  for (int n = 0; n + 1 < last; ++n) {
+    Complex z(orbit.zx[n], orbit.zy[n]), next(orbit.zx[n + 1], orbit.zy[n + 1]);
+    Complex na = 2.0 * z * a + 1.0, nb = 2.0 * z * b + a * a, nc = 2.0 * z * c + 2.0 * a * b;
+    bool accurate = true;
+    for (int p = 0; p < 4; ++p) {
+      delta[p] = 2.0 * z * delta[p] + delta[p] * delta[p] + dc[p];
+      Complex approximation = ((nc * dc[p] + nb) * dc[p] + na) * dc[p];
+      if (std::abs(approximation - delta[p]) > tolerance * std::abs(delta[p]) || std::norm(next + delta[p]) > 4.0) accurate = false;
+    }
+    if (!accurate) break;
+    a = na;
+    b = nb;
+    c = nc;
+    orbit.skip = n + 1;
+  }
+  orbit.ax = a.real(); orbit.ay = a.imag();
+  orbit.bx = b.real(); orbit.by = b.imag();
+  orbit.cx = c.real(); orbit.cy = c.imag();
+}
+
+// Escape count of the pixel at offset (dcx, dcy) from the viewport centre, iterated as a
+// delta from `orbit`, or -1 once the delta has swamped the orbit and lost its precision.
+// A pixel that outlives the reference is rebased onto its start: z = Z_0 + z since Z_0 = 0.
+int perturbPixel(const ReferenceOrbit& orbit, double dcx, double dcy, int maxIterations) 
+{
+  dcx -= orbit.offsetX;
+  dcy -= orbit.offsetY;
+  double dx = 0.0, dy = 0.0;
+  int m = 0, iterations = 0, last = orbit.zx.size() - 1;
+  if (orbit.skip > 0) {
+    double d2x = dcx * dcx - dcy * dcy, d2y = 2.0 * dcx * dcy;
+    double d3x = d2x * dcx - d2y * dcy, d3y = d2x * dcy + d2y * dcx;
+    dx = orbit.ax * dcx - orbit.ay * dcy + orbit.bx * d2x - orbit.by * d2y + orbit.cx * d3x - orbit.cy * d3y;
+    dy = orbit.ax * dcy + orbit.ay * dcx + orbit.bx * d2y + orbit.by * d2x + orbit.cx * d3y + orbit.cy * d3x;
+    m = iterations = orbit.skip;
+  }
+  while (iterations < maxIterations) {
+    double zx = orbit.zx[m], zy = orbit.zy[m];
+    double nx = 2.0 * (zx * dx - zy * dy) + (dx * dx - dy * dy) + dcx;
+    double ny = 2.0 * (zx * dy + zy * dx) + 2.0 * dx * dy + dcy;
+    dx = nx;
+    dy = ny;
+    m++;
+    iterations++;
+    zx = orbit.zx[m] + dx;
+    zy = orbit.zy[m] + dy;
+    double magnitude = zx * zx + zy * zy;
+    if (magnitude > 4.0) return iterations;
+    if (magnitude < orbit.glitchLimit[m]) return -1;
+    if (m == last) {
+      dx = zx;
+      dy = zy;
+      m = 0;
+    }
+  }
+  return maxIterations;
+}
+
+double deepOffsetX(int i, int width) 
+{
+  return (i - width / 2.0) * view.scale / width;
+}
+
+double deepOffsetY(int j, int height) 
+{
+  return (j - height / 2.0) * view.scale / height;
+}
+
+void prepareDeepZoom(int width, int height, int maxIterations) 
+{
+  primaryOrbit = computeReferenceOrbit(0.0, 0.0, maxIterations);
+  if (seriesApproximation) fitSeriesApproximation(primaryOrbit, view.scale / 2.0, view.scale / 2.0);
+  glitched.assign(width * height, 0);
+  deepStats = DeepZoomStats();
+  deepStats.referenceLength = primaryOrbit.zx.size() - 1;
+}
+
+// Counts for columns [x0, x1) of row j against the primary reference; glitched pixels
+// get maxIterations for now and are flagged for resolveGlitches()
+void deepZoomSpan(int width, int height, int maxIterations, int j, int x0, int x1, int* iterations) 
+{
+  double dcy = deepOffsetY(j, height);
+  for (int i = x0; i < x1; ++i) {
+    int count = perturbPixel(primaryOrbit, deepOffsetX(i, width), dcy, maxIterations);
+    if (count < 0) {
+      glitched[j * width + i] = 1;
+      count = maxIterations;
+    }
+    iterations[i - x0] = count;
+  }
+}
+
+// Re-renders glitched pixels against secondary references, each placed on a pixel that
+// is still glitched (its own delta is zero, so every round fixes at least that pixel)
+void resolveGlitches(int width, int height, int maxIterations, std::vector<RGB>& image) 
+{
+  std::vector<int> pending;
+  for (int p = 0; p < width * height; ++p)
+    if (glitched[p]) pending.push_back(p);
+  deepStats.glitched = pending.size();
+  while (!pending.empty() && deepStats.secondaryReferences < MAX_SECONDARY_REFERENCES) {
+    int pick = pending[pending.size() / 2];
+    ReferenceOrbit orbit = computeReferenceOrbit(deepOffsetX(pick % width, width), deepOffsetY(pick / width, height), maxIterations);
+    deepStats.secondaryReferences++;
+    std::vector<int> counts(pending.size());
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t k = 0; k < pending.size(); ++k)
+      counts[k] = perturbPixel(orbit, deepOffsetX(pending[k] % width, width), deepOffsetY(pending[k] / width, height), maxIterations);
+    std::vector<int> remaining;
+    for (size_t k = 0; k < pending.size(); ++k) {
+      if (counts[k] < 0) remaining.push_back(pending[k]);
+      else image[pending[k]] = getColor(counts[k], maxIterations);
+    }
+    pending.swap(remaining);
+  }
+  deepStats.unresolved = pending.size();
+}
+
+void reportDeepZoom() 
+{
+  if (!deepZoom) return;
+  std::cout << "Deep zoom: reference orbit of " << deepStats.referenceLength << " iterations, " << primaryOrbit.skip
+            << " skipped by series approximation, " << deepStats.glitched << " glitched pixels, "
+            << deepStats.secondaryReferences << " secondary references, " << deepStats.unresolved << " unresolved\n";
+}
+
+// Computes and colours rows [startRow, endRow) one vectorised row span at a time
+void computeMandelbrotRows(int width, int height, int maxIterations, const std::vector<double>& x0s, std::vector<RGB>& image, int startRow, int endRow) 
+{
+  std::vector<int> iterations(width);
+  for (int j = startRow; j < endRow; ++j) {
+    if (deepZoom) deepZoomSpan(width, height, maxIterations, j, 0, width, iterations.data());
+    else spanKernel(x0s.data(), rowCoordinate(j, height), width, maxIterations, iterations.data());
+    for (int i = 0; i < width; ++i) image[j * width + i] = getColor(iterations[i], maxIterations);
+  }
+}
+
 void computeMandelbrotSection(int width, int height, int maxIterations, std::vector<RGB>& image, int startRow, int endRow) 
 {
-  for (int i = 0; i < width; ++i) {
-    for (int j = startRow; j < endRow; ++j) {
-      double x0 = (i - width / 2.0) * 4.0 / width;
-      double y0 = (j - height / 2.0) * 4.0 / height;
-      int iterations = mandelbrot(x0, y0, maxIterations);
-      image[j * width + i] = getColor(iterations, maxIterations);
+  std::vector<double> x0s = columnCoordinates(width);
+  computeMandelbrotRows(width, height, maxIterations, x0s, image, startRow, endRow);
+}
+
+struct Tile {
+  int x0, y0, x1, y1;
+};
+
+// Tile queue of one worker: the owner pops from the back, thieves take from the front,
+// so they steal the tiles furthest from what the owner is working on
+class TileDeque 
+{
+public:
+  void push(const Tile& tile) 
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    tiles.push_back(tile);
+  }
+
+  bool pop(Tile& tile) 
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tiles.empty()) return false;
+    tile = tiles.back();
+    tiles.pop_back();
+    return true;
+  }
+
+  bool steal(Tile& tile) 
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tiles.empty()) return false;
+    tile = tiles.front();
+    tiles.pop_front();
+    return true;
+  }
+
+private:
+  std::deque<Tile> tiles;
+  std::mutex lock;
+};
+
+// idleSeconds covers failed or successful steal searches; the time a worker waits
+// for the others after running out of tiles is added once all of them are joined
+struct WorkerStats {
+  int tilesDone = 0;
+  int steals = 0;
+  double idleSeconds = 0.0;
+  std::chrono::high_resolution_clock::time_point finished;
+};
+
+// Accelerated render mode (-a): interior points are rejected analytically or by orbit
+// periodicity, and Mariani-Silver subdivision fills rectangles with a uniform border
+bool accelerated = false;
+
+struct PixelCounters {
+  long iterated = 0;  // escape-time loop actually run
+  long interior = 0;  // rejected by the cardioid / period-2 bulb test
+  long periodic = 0;  // loop stopped early because the orbit repeated
+  long filled = 0;    // never evaluated, filled from a uniform rectangle border
+};
+
+std::atomic<long> totalIterated(0), totalInterior(0), totalPeriodic(0), totalFilled(0);
+
+void addPixelCounters(const PixelCounters& counters) 
+{
+  totalIterated += counters.iterated;
+  totalInterior += counters.interior;
+  totalPeriodic += counters.periodic;
+  totalFilled += counters.filled;
+}
+
+// mandelbrot() with two shortcuts that return maxIterations for points in the set:
+// the closed-form main cardioid / period-2 bulb tests, and Brent-style cycle detection.
+// The cycle check compares orbit points exactly: once the double-precision orbit
+// repeats it can never escape, so the count is the same mandelbrot() would return.
+__attribute__((optimize("fp-contract=off"))) int mandelbrotAccelerated(double x0, double y0, int maxIterations, PixelCounters& counters) 
+{
+  double xq = x0 - 0.25;
+  double q = xq * xq + y0 * y0;
+  if (q * (q + xq) <= 0.25 * y0 * y0 || (x0 + 1.0) * (x0 + 1.0) + y0 * y0 <= 0.0625) {
+    counters.interior++;
+    return maxIterations;
+  }
+  counters.iterated++;
+  double x = 0.0, y = 0.0, savedX = 0.0, savedY = 0.0;
+  int iterations = 0, nextSave = 1;
+  while (x * x + y * y <= 4.0 && iterations < maxIterations) {
+    double xtemp = x * x - y * y + x0;
+    y = 2.0 * x * y + y0;
+    x = xtemp;
+    iterations++;
+    if (x == savedX && y == savedY) {
+      counters.periodic++;
+      return maxIterations;
+    }
+    if (iterations == nextSave) {
+      savedX = x;
+      savedY = y;
+      nextSave *= 2;
+    }
+  }
+  return iterations;
+}
+
+// Mariani-Silver over the inclusive rectangle [x0, x1] x [y0, y1] of a tile whose
+// counts live in `counts` (row stride `stride`, -1 = not computed yet, origin at the
+// tile corner): evaluate the border, flood-fill the inside when the border is uniform,
+// otherwise split along the longer side and recurse; small rectangles are evaluated whole
+void marianiSilver(int width, int height, int maxIterations, const std::vector<double>& x0s, const Tile& tile, std::vector<int>& counts, int stride, int x0, int y0, int x1, int y1, PixelCounters& counters) 
+{
+  auto evaluate = [&](int i, int j) {
+    int& count = counts[(j - tile.y0) * stride + (i - tile.x0)];
+    if (count < 0) count = mandelbrotAccelerated(x0s[i], rowCoordinate(j, height), maxIterations, counters);
+    return count;
+  };
+
+  int first = evaluate(x0, y0);
+  bool uniform = true;
+  for (int i = x0; i <= x1; ++i) {
+    uniform = (evaluate(i, y0) == first) && uniform;
+    uniform = (evaluate(i, y1) == first) && uniform;
+  }
+  for (int j = y0 + 1; j < y1; ++j) {
+    uniform = (evaluate(x0, j) == first) && uniform;
+    uniform = (evaluate(x1, j) == first) && uniform;
+  }
+  if (x1 - x0 < 2 || y1 - y0 < 2) return;
+
+  if (uniform) {
+    for (int j = y0 + 1; j < y1; ++j) {
+      for (int i = x0 + 1; i < x1; ++i) {
+        int& count = counts[(j - tile.y0) * stride + (i - tile.x0)];
+        if (count < 0) {
+          count = first;
+          counters.filled++;
+        }
+      }
     }
+  } else if (x1 - x0 < 6 || y1 - y0 < 6) {
+    for (int j = y0 + 1; j < y1; ++j)
+      for (int i = x0 + 1; i < x1; ++i) evaluate(i, j);
+  } else if (x1 - x0 >= y1 - y0) {
+    int xm = (x0 + x1) / 2;
+    marianiSilver(width, height, maxIterations, x0s, tile, counts, stride, x0, y0, xm, y1, counters);
+    marianiSilver(width, height, maxIterations, x0s, tile, counts, stride, xm, y0, x1, y1, counters);
+  } else {
+    int ym = (y0 + y1) / 2;
+    marianiSilver(width, height, maxIterations, x0s, tile, counts, stride, x0, y0, x1, ym, counters);
+    marianiSilver(width, height, maxIterations, x0s, tile, counts, stride, x0, ym, x1, y1, counters);
   }
 }
 
-void parallelMandelbrot(int width, int height, int maxIterations, const char* filename, int numThreads) 
+void computeMandelbrotTileAccelerated(int width, int height, int maxIterations, const std::vector<double>& x0s, std::vector<RGB>& image, const Tile& tile, std::vector<int>& counts) 
+{
+  int tileWidth = tile.x1 - tile.x0, tileHeight = tile.y1 - tile.y0;
+  counts.assign(tileWidth * tileHeight, -1);
+  PixelCounters counters;
+  marianiSilver(width, height, maxIterations, x0s, tile, counts, tileWidth, tile.x0, tile.y0, tile.x1 - 1, tile.y1 - 1, counters);
+  for (int j = tile.y0; j < tile.y1; ++j)
+    for (int i = tile.x0; i < tile.x1; ++i) image[j * width + i] = getColor(counts[(j - tile.y0) * tileWidth + (i - tile.x0)], maxIterations);
+  addPixelCounters(counters);
+}
+
+void reportAcceleration(int width, int height) 
+{
+  if (!accelerated) return;
+  double pixels = static_cast<double>(width) * height;
+  std::cout << "Accelerated: " << totalIterated << " pixels iterated (" << 100.0 * totalIterated / pixels << "%), "
+            << totalPeriodic << " of them stopped by periodicity, " << totalInterior << " cardioid/bulb, "
+            << totalFilled << " filled (" << 100.0 * totalFilled / pixels << "%)\n";
+}
+
+// Computes and colours one tile, row-major so every span is a contiguous run of the image
+void computeMandelbrotTile(int width, int height, int maxIterations, const std::vector<double>& x0s, std::vector<RGB>& image, const Tile& tile, std::vector<int>& iterations) 
+{
+  if (accelerated && !deepZoom) {
+    computeMandelbrotTileAccelerated(width, height, maxIterations, x0s, image, tile, iterations);
+    return;
+  }
+  for (int j = tile.y0; j < tile.y1; ++j) {
+    if (deepZoom) deepZoomSpan(width, height, maxIterations, j, tile.x0, tile.x1, iterations.data());
+    else spanKernel(x0s.data() + tile.x0, rowCoordinate(j, height), tile.x1 - tile.x0, maxIterations, iterations.data());
+    for (int i = tile.x0; i < tile.x1; ++i) image[j * width + i] = getColor(iterations[i - tile.x0], maxIterations);
+  }
+}
+
+// Worker loop: drain the own deque, then steal from the other workers starting at a
+// pseudo-random victim. Tiles are never re-queued, so one full scan that finds every
+// deque empty means the image is done.
+void mandelbrotWorker(int self, int width, int height, int maxIterations, const std::vector<double>& x0s, std::vector<RGB>& image, std::vector<TileDeque>& deques, WorkerStats& stats) 
+{
+  int numWorkers = deques.size();
+  std::vector<int> iterations(width);
+  unsigned int seed = 2463534242u + self * 747796405u;
+  Tile tile;
+  while (true) {
+    if (deques[self].pop(tile)) {
+      computeMandelbrotTile(width, height, maxIterations, x0s, image, tile, iterations);
+      stats.tilesDone++;
+      continue;
+    }
+    auto idleStart = std::chrono::high_resolution_clock::now();
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    bool stolen = false;
+    for (int k = 0; k < numWorkers && !stolen; ++k) {
+      int victim = (seed + k) % numWorkers;
+      if (victim != self) stolen = deques[victim].steal(tile);
+    }
+    stats.idleSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - idleStart).count();
+    if (!stolen) break;
+    stats.steals++;
+    computeMandelbrotTile(width, height, maxIterations, x0s, image, tile, iterations);
+    stats.tilesDone++;
+  }
+  stats.finished = std::chrono::high_resolution_clock::now();
+}
+
+void parallelMandelbrot(int width, int height, int maxIterations, const char* filename, int numThreads, int tileWidth, int tileHeight, bool verbose) 
 {
   auto start = std::chrono::high_resolution_clock::now();
   std::vector<RGB> image(width * height);
-  // your code here
+  std::vector<double> x0s = columnCoordinates(width);
+  if (deepZoom) prepareDeepZoom(width, height, maxIterations);
+
+  // row-major tile order, dealt out in contiguous runs so each worker starts on its own band
+  std::vector<Tile> tiles;
+  for (int y = 0; y < height; y += tileHeight)
+    for (int x = 0; x < width; x += tileWidth)
+      tiles.push_back({x, y, std::min(x + tileWidth, width), std::min(y + tileHeight, height)});
+  std::vector<TileDeque> deques(numThreads);
+  for (int t = 0; t < numThreads; ++t) {
+    size_t first = tiles.size() * t / numThreads, last = tiles.size() * (t + 1) / numThreads;
+    // pushed in reverse so the owner pops its band top to bottom
+    for (size_t k = last; k > first; --k) deques[t].push(tiles[k - 1]);
+  }
+
+  std::vector<WorkerStats> stats(numThreads);
   std::vector<std::thread> threads;
-  int numRows = height / numThreads;
   for(int t = 0; t < numThreads; ++t){
-    int startRow = t * numRows;
-    int endRow = (t == numThreads - 1)? height : startRow + numRows;
-    threads.emplace_back(computeMandelbrotSection, width, height, maxIterations, std::ref(image), startRow, endRow); 
+    threads.emplace_back(mandelbrotWorker, t, width, height, maxIterations, std::cref(x0s), std::ref(image), std::ref(deques), std::ref(stats[t]));
   }
   for(int t = 0; t < numThreads; t++)
     threads[t].join();
+  if (deepZoom) resolveGlitches(width, height, maxIterations, image);
   auto end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsed = end - start;
   std::cout << "Parallel Mandelbrot with " << numThreads << " threads took " << elapsed.count() << " seconds\n";
 
+  int minTiles = tiles.size(), maxTiles = 0, totalSteals = 0;
+  double maxIdle = 0.0;
+  auto lastFinished = stats[0].finished;
+  for (int t = 0; t < numThreads; ++t) lastFinished = std::max(lastFinished, stats[t].finished);
+  for (int t = 0; t < numThreads; ++t) {
+    stats[t].idleSeconds += std::chrono::duration<double>(lastFinished - stats[t].finished).count();
+    if (verbose) std::cout << "  thread " << t << ": " << stats[t].tilesDone << " tiles, " << stats[t].steals << " steals, " << stats[t].idleSeconds << " s idle\n";
+    minTiles = std::min(minTiles, stats[t].tilesDone);
+    maxTiles = std::max(maxTiles, stats[t].tilesDone);
+    totalSteals += stats[t].steals;
+    maxIdle = std::max(maxIdle, stats[t].idleSeconds);
+  }
+  std::cout << "Scheduler: " << tiles.size() << " tiles of " << tileWidth << "x" << tileHeight << ", " << minTiles << ".." << maxTiles
+            << " tiles per thread, " << totalSteals << " steals, max idle " << maxIdle << " s\n";
+  reportAcceleration(width, height);
+  reportDeepZoom();
+
   writeImage(filename, width, height, image);
 }
 
@@ -79,45 +892,407 @@ void serialMandelbrot(int width, int height, int maxIterations, const char* file
 {
   auto start = std::chrono::high_resolution_clock::now();
   std::vector<RGB> image(width * height);
-  for (int i = 0; i < width; ++i) {
-    for (int j = 0; j < height; ++j) {
-      double x0 = (i - width / 2.0) * 4.0 / width;
-      double y0 = (j - height / 2.0) * 4.0 / height;
-      int iterations = mandelbrot(x0, y0, maxIterations);
-      image[j * width + i] = getColor(iterations, maxIterations);
-    }
+  if (deepZoom) {
+    prepareDeepZoom(width, height, maxIterations);
+    computeMandelbrotSection(width, height, maxIterations, image, 0, height);
+    resolveGlitches(width, height, maxIterations, image);
+  } else if (accelerated) {
+    // the whole image is one Mariani-Silver root rectangle
+    std::vector<double> x0s = columnCoordinates(width);
+    std::vector<int> counts;
+    computeMandelbrotTileAccelerated(width, height, maxIterations, x0s, image, {0, 0, width, height}, counts);
+  } else {
+    computeMandelbrotSection(width, height, maxIterations, image, 0, height);
   }
   auto end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsed = end - start;
   std::cout << "Serial Mandelbrot took " << elapsed.count() << " seconds\n";
+  reportAcceleration(width, height);
+  reportDeepZoom();
   writeImage(filename, width, height, image);
 }
 
+// Renders into image with the current OMP team size
+void renderMandelbrotOMP(int width, int height, int maxIterations, std::vector<RGB>& image) 
+{
+  std::vector<double> x0s = columnCoordinates(width);
+  if (deepZoom) prepareDeepZoom(width, height, maxIterations);
+  if (accelerated && !deepZoom) {
+    // 64x64 Mariani-Silver root tiles, handed out dynamically
+    int tilesX = (width + 63) / 64, tilesY = (height + 63) / 64;
+    #pragma omp parallel
+    {
+      std::vector<int> counts;
+      #pragma omp for schedule(dynamic)
+      for (int t = 0; t < tilesX * tilesY; ++t) {
+        int x = t % tilesX * 64, y = t / tilesX * 64;
+        computeMandelbrotTileAccelerated(width, height, maxIterations, x0s, image, {x, y, std::min(x + 64, width), std::min(y + 64, height)}, counts);
+      }
+    }
+  } else {
+    #pragma omp parallel for schedule(dynamic)
+    for (int j = 0; j < height; ++j) {
+      computeMandelbrotRows(width, height, maxIterations, x0s, image, j, j + 1);
+    }
+  }
+  if (deepZoom) resolveGlitches(width, height, maxIterations, image);
+}
+
 void OMPMandelbrot(int width, int height, int maxIterations, const char* filename) 
 {
   auto start = std::chrono::high_resolution_clock::now();
   std::vector<RGB> image(width * height);
   // your code here
-  #pragma omp parallel for collapse(2)
-  for (int i = 0; i < width; ++i) {
-    for (int j = 0; j < height; ++j) {
-      double x0 = (i - width / 2.0) * 4.0 / width;
-      double y0 = (j - height / 2.0) * 4.0 / height;
-      int iterations = mandelbrot(x0, y0, maxIterations);
-      image[j * width + i] = getColor(iterations, maxIterations);
-    }
-  }
+  renderMandelbrotOMP(width, height, maxIterations, image);
   auto end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsed = end - start;
   std::cout << "OMP Mandelbrot took " << elapsed.count() << " seconds\n";
+  reportAcceleration(width, height);
+  reportDeepZoom();
   writeImage(filename, width, height, image);
 }
 
+// Tile-addressed renderer for pans and zoom sequences. Zoom level z has square pixels of
+// side 4 / (width * 2^z) on a grid anchored at the origin, so tile (z, tx, ty) always
+// covers the same points and its iteration counts can be reused by any frame touching it.
+const int CACHE_TILE = 64;
+
+struct TileKey {
+  int level;
+  long long tx, ty;
+  int maxIterations;
+
+  bool operator==(const TileKey& other) const 
+  {
+    return level == other.level && tx == other.tx && ty == other.ty && maxIterations == other.maxIterations;
+  }
+};
+
+struct TileKeyHash {
+  size_t operator()(const TileKey& key) const 
+  {
+    size_t h = std::hash<long long>()(key.tx);
+    h = h * 1000003u ^ std::hash<long long>()(key.ty);
+    h = h * 1000003u ^ std::hash<int>()(key.level);
+    return h * 1000003u ^ std::hash<int>()(key.maxIterations);
+  }
+};
+
+typedef std::shared_ptr<const std::vector<int>> TileCounts;
+
+// LRU cache of iteration-count tiles bounded by a byte budget. Entries are shared, so
+// evicting a tile that the current frame is still composing from is safe.
+class TileCache 
+{
+public:
+  explicit TileCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+  TileCounts find(const TileKey& key) 
+  {
+    auto it = index.find(key);
+    if (it == index.end()) {
+      misses++;
+      return nullptr;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+
+  void insert(const TileKey& key, const TileCounts& counts) 
+  {
+    entries.emplace_front(key, counts);
+    index[key] = entries.begin();
+    bytes += counts->size() * sizeof(int);
+    while (bytes > budget && entries.size() > 1) {
+      bytes -= entries.back().second->size() * sizeof(int);
+      index.erase(entries.back().first);
+      entries.pop_back();
+      evictions++;
+    }
+  }
+
+  size_t size() const { return entries.size(); }
+  size_t usedBytes() const { return bytes; }
+
+  long hits = 0, misses = 0, evictions = 0;
+
+private:
+  typedef std::list<std::pair<TileKey, TileCounts>> EntryList;
+  EntryList entries;  // most recently used first
+  std::unordered_map<TileKey, EntryList::iterator, TileKeyHash> index;
+  size_t budget, bytes = 0;
+};
+
+double levelSpacing(int width, int level) 
+{
+  return 4.0 / width / std::ldexp(1.0, level);
+}
+
+long long floorDiv(long long a, long long b) 
+{
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+TileCounts computeCacheTile(const TileKey& key, double spacing) 
+{
+  auto counts = std::make_shared<std::vector<int>>(CACHE_TILE * CACHE_TILE);
+  double x0s[CACHE_TILE];
+  for (int i = 0; i < CACHE_TILE; ++i) x0s[i] = (key.tx * CACHE_TILE + i) * spacing;
+  for (int r = 0; r < CACHE_TILE; ++r)
+    spanKernel(x0s, (key.ty * CACHE_TILE + r) * spacing, CACHE_TILE, key.maxIterations, counts->data() + r * CACHE_TILE);
+  return counts;
+}
+
+struct FrameStats {
+  int tiles = 0, hits = 0;
+  double seconds = 0.0;
+};
+
+// Renders the width x height frame centred on (centerX, centerY) at `level`; the centre is
+// snapped to the pixel grid. Cached tiles are looked up first, the missing ones computed
+// in parallel and inserted afterwards, so the cache itself needs no locking.
+void renderCachedFrame(TileCache& cache, int width, int height, int maxIterations, int level, double centerX, double centerY, std::vector<RGB>& image, FrameStats& stats) 
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  double spacing = levelSpacing(width, level);
+  long long originX = std::llround(centerX / spacing) - width / 2, originY = std::llround(centerY / spacing) - height / 2;
+  long long tx0 = floorDiv(originX, CACHE_TILE), ty0 = floorDiv(originY, CACHE_TILE);
+  int tilesX = floorDiv(originX + width - 1, CACHE_TILE) - tx0 + 1, tilesY = floorDiv(originY + height - 1, CACHE_TILE) - ty0 + 1;
+
+  auto keyOf = [&](int t) { return TileKey{level, tx0 + t % tilesX, ty0 + t / tilesX, maxIterations}; };
+  std::vector<TileCounts> tiles(tilesX * tilesY);
+  std::vector<int> missing;
+  for (int t = 0; t < tilesX * tilesY; ++t) {
+    tiles[t] = cache.find(keyOf(t));
+    if (!tiles[t]) missing.push_back(t);
+  }
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t m = 0; m < missing.size(); ++m) tiles[missing[m]] = computeCacheTile(keyOf(missing[m]), spacing);
+  for (int t : missing) cache.insert(keyOf(t), tiles[t]);
+
+  #pragma omp parallel for
+  for (int j = 0; j < height; ++j) {
+    long long gy = originY + j, ty = floorDiv(gy, CACHE_TILE);
+    int row = gy - ty * CACHE_TILE;
+    for (int i = 0; i < width;) {
+      long long gx = originX + i, tx = floorDiv(gx, CACHE_TILE);
+      int column = gx - tx * CACHE_TILE, run = std::min<long long>(CACHE_TILE - column, width - i);
+      const int* counts = tiles[(ty - ty0) * tilesX + (tx - tx0)]->data() + row * CACHE_TILE + column;
+      for (int k = 0; k < run; ++k) image[j * width + i + k] = getColor(counts[k], maxIterations);
+      i += run;
+    }
+  }
+
+  stats.tiles = tilesX * tilesY;
+  stats.hits = stats.tiles - missing.size();
+  stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// "out.png" + 7 -> "out_0007.png"
+std::string frameFilename(const std::string& filename, int frame) 
+{
+  char number[16];
+  std::snprintf(number, sizeof(number), "_%04d", frame);
+  size_t dot = filename.rfind('.');
+  if (dot == std::string::npos) return filename + number;
+  return filename.substr(0, dot) + number + filename.substr(dot);
+}
+
+// Frame-sequence mode (-Z): zooms from the viewport scale `levels` powers of two into the
+// viewport centre and back out, drifting in a small circle so consecutive frames at the
+// same level pan against each other. Frame latency covers rendering, not encoding.
+void zoomSequence(int width, int height, int maxIterations, const char* filename, int frames, int levels, size_t budgetBytes) 
+{
+  TileCache cache(budgetBytes);
+  std::vector<RGB> image(width * height);
+  int baseLevel = std::max(0L, std::lround(std::log2(4.0 / view.scale)));
+  long tiles = 0, hits = 0;
+  double totalSeconds = 0.0, maxSeconds = 0.0;
+  for (int f = 0; f < frames; ++f) {
+    double u = frames > 1 ? f / (frames - 1.0) : 0.0;
+    int level = baseLevel + std::lround((1.0 - std::fabs(2.0 * u - 1.0)) * levels);
+    double drift = 24.0 * levelSpacing(width, level), angle = 2.0 * M_PI * f / 16.0;
+    FrameStats stats;
+    renderCachedFrame(cache, width, height, maxIterations, level, view.centerX + drift * std::cos(angle), view.centerY + drift * std::sin(angle), image, stats);
+    std::cout << "Frame " << f << ": level " << level << ", " << stats.hits << "/" << stats.tiles << " tiles cached, "
+              << stats.seconds * 1000.0 << " ms\n";
+    tiles += stats.tiles;
+    hits += stats.hits;
+    totalSeconds += stats.seconds;
+    maxSeconds = std::max(maxSeconds, stats.seconds);
+    writeImage(frameFilename(filename, f).c_str(), width, height, image);
+  }
+  std::cout << "Zoom sequence: " << frames << " frames, tile hit rate " << (tiles ? 100.0 * hits / tiles : 0.0) << "% ("
+            << hits << " of " << tiles << "), frame latency mean " << totalSeconds / frames * 1000.0 << " ms, max "
+            << maxSeconds * 1000.0 << " ms\n";
+  std::cout << "Tile cache: " << cache.size() << " tiles, " << cache.usedBytes() / 1048576.0 << " of "
+            << budgetBytes / 1048576.0 << " MB, " << cache.evictions << " evictions\n";
+}
+
+// Batch mode (-b): frames from a spec file go through a two-stage pipeline. The calling
+// thread renders frame k+1 with an OMP team while encoder threads compress and write
+// frame k. Image buffers circulate between a free list and the ready queue, so the
+// only allocations are the up-front ones.
+template <typename T>
+class BoundedQueue 
+{
+public:
+  explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+  void push(T item) 
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    notFull.wait(guard, [&] { return items.size() < capacity; });
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+  }
+
+  // false once the queue is closed and drained
+  bool pop(T& item) 
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    notEmpty.wait(guard, [&] { return !items.empty() || closed; });
+    if (items.empty()) return false;
+    item = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+
+  void close() 
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    notEmpty.notify_all();
+  }
+
+private:
+  std::deque<T> items;
+  size_t capacity;
+  bool closed = false;
+  std::mutex lock;
+  std::condition_variable notFull, notEmpty;
+};
+
+// One line per frame: width height centerX centerY scale filename ('#' starts a comment)
+struct FrameSpec {
+  int width, height;
+  DoubleDouble centerX, centerY;
+  double scale;
+  std::string filename;
+};
+
+std::vector<FrameSpec> readFrameSpecs(const char* path) 
+{
+  std::vector<FrameSpec> specs;
+  std::ifstream in(path);
+  if (!in) std::cerr << "Cannot open frame list " << path << "\n";
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    FrameSpec spec;
+    std::string centerX, centerY;
+    if (line.empty() || line[0] == '#') continue;
+    if (!(fields >> spec.width >> spec.height >> centerX >> centerY >> spec.scale >> spec.filename)) {
+      std::cerr << "Skipping malformed frame spec: " << line << "\n";
+      continue;
+    }
+    spec.centerX = parseDoubleDouble(centerX.c_str());
+    spec.centerY = parseDoubleDouble(centerY.c_str());
+    specs.push_back(spec);
+  }
+  return specs;
+}
+
+struct FrameJob {
+  const FrameSpec* spec;
+  std::vector<RGB>* image;
+};
+
+void encoderWorker(BoundedQueue<FrameJob>& ready, BoundedQueue<std::vector<RGB>*>& freeBuffers, double& busySeconds) 
+{
+  // each encoder compresses its frame serially; the parallelism is across frames
+  omp_set_num_threads(1);
+  FrameJob job;
+  while (ready.pop(job)) {
+    auto start = std::chrono::high_resolution_clock::now();
+    const FrameSpec& spec = *job.spec;
+    std::vector<unsigned char> encoded = writesPPM(spec.filename.c_str()) ? encodePPM(spec.width, spec.height, *job.image) : encodePNG(spec.width, spec.height, *job.image);
+    writeFile(spec.filename.c_str(), encoded);
+    busySeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    freeBuffers.push(job.image);
+  }
+}
+
+void batchMandelbrot(const char* specPath, int maxIterations, int computeThreads, int encodeThreads, int queueDepth) 
+{
+  std::vector<FrameSpec> specs = readFrameSpecs(specPath);
+  if (specs.empty()) return;
+  size_t maxPixels = 0;
+  for (const FrameSpec& spec : specs) maxPixels = std::max(maxPixels, static_cast<size_t>(spec.width) * spec.height);
+
+  // enough buffers for the one being rendered, the queued ones and one per encoder
+  int numBuffers = queueDepth + encodeThreads + 1;
+  std::vector<std::vector<RGB>> buffers(numBuffers);
+  BoundedQueue<std::vector<RGB>*> freeBuffers(numBuffers);
+  BoundedQueue<FrameJob> ready(queueDepth);
+  for (std::vector<RGB>& buffer : buffers) {
+    buffer.reserve(maxPixels);
+    freeBuffers.push(&buffer);
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<double> encodeBusy(encodeThreads, 0.0);
+  std::vector<std::thread> encoders;
+  for (int e = 0; e < encodeThreads; ++e) encoders.emplace_back(encoderWorker, std::ref(ready), std::ref(freeBuffers), std::ref(encodeBusy[e]));
+
+  omp_set_num_threads(computeThreads);
+  double computeBusy = 0.0, computeStalled = 0.0;
+  for (const FrameSpec& spec : specs) {
+    auto waitStart = std::chrono::high_resolution_clock::now();
+    std::vector<RGB>* image = nullptr;
+    freeBuffers.pop(image);
+    auto renderStart = std::chrono::high_resolution_clock::now();
+    image->resize(static_cast<size_t>(spec.width) * spec.height);
+    view.centerX = spec.centerX.hi;
+    view.centerY = spec.centerY.hi;
+    view.scale = spec.scale;
+    deepCenterX = spec.centerX;
+    deepCenterY = spec.centerY;
+    renderMandelbrotOMP(spec.width, spec.height, maxIterations, *image);
+    auto renderEnd = std::chrono::high_resolution_clock::now();
+    ready.push({&spec, image});
+    auto pushEnd = std::chrono::high_resolution_clock::now();
+    computeBusy += std::chrono::duration<double>(renderEnd - renderStart).count();
+    computeStalled += std::chrono::duration<double>(renderStart - waitStart).count() + std::chrono::duration<double>(pushEnd - renderEnd).count();
+  }
+  ready.close();
+  for (std::thread& encoder : encoders) encoder.join();
+  double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  double totalEncodeBusy = 0.0;
+  for (double busy : encodeBusy) totalEncodeBusy += busy;
+  std::cout << "Pipeline: " << specs.size() << " frames in " << elapsed << " seconds, " << specs.size() / elapsed << " frames/s\n";
+  std::cout << "  compute (" << computeThreads << " threads): " << 100.0 * computeBusy / elapsed << "% busy, "
+            << computeStalled << " s stalled on buffers or a full queue\n";
+  std::cout << "  encode (" << encodeThreads << " threads): " << 100.0 * totalEncodeBusy / (elapsed * encodeThreads) << "% busy on average";
+  for (int e = 0; e < encodeThreads; ++e) std::cout << (e == 0 ? " [" : ", ") << 100.0 * encodeBusy[e] / elapsed << "%";
+  std::cout << "]\n";
+}
+
 int main(int argc, char* argv[]) 
 {
   int width = 480, height = 480, maxIterations = 1000, numThreads = 1;
   bool useOMP = false;
   const char* filename = "out.png";
+  std::string kernelName = "auto";
+  int tileWidth = 64, tileHeight = 16;
+  bool verbose = false;
+  int frames = 0, zoomLevels = 6;
+  size_t cacheBudgetMB = 256;
+  const char* frameList = nullptr;
+  int encodeThreads = 1, queueDepth = 2;
   
   for (int i = 1; i < argc; ++i) {
     if (std::string(argv[i]) == "-o") filename = argv[++i];
@@ -125,10 +1300,35 @@ int main(int argc, char* argv[])
     else if (std::string(argv[i]) == "-h") height = std::atoi(argv[++i]);
     else if (std::string(argv[i]) == "-n") numThreads = std::atoi(argv[++i]);
     else if (std::string(argv[i]) == "-O") useOMP = true;
+    else if (std::string(argv[i]) == "-k") kernelName = argv[++i];
+    else if (std::string(argv[i]) == "-t") { tileWidth = std::atoi(argv[++i]); tileHeight = std::atoi(argv[++i]); }
+    else if (std::string(argv[i]) == "-v") verbose = true;
+    else if (std::string(argv[i]) == "-a") accelerated = true;
+    else if (std::string(argv[i]) == "-f") imageFormat = std::string(argv[++i]) == "ppm" ? FORMAT_PPM : FORMAT_PNG;
+    else if (std::string(argv[i]) == "-c") {
+      deepCenterX = parseDoubleDouble(argv[++i]);
+      deepCenterY = parseDoubleDouble(argv[++i]);
+      view.centerX = deepCenterX.hi;
+      view.centerY = deepCenterY.hi;
+    }
+    else if (std::string(argv[i]) == "-s") view.scale = std::atof(argv[++i]);
+    else if (std::string(argv[i]) == "-Z") { frames = std::atoi(argv[++i]); zoomLevels = std::atoi(argv[++i]); }
+    else if (std::string(argv[i]) == "-M") cacheBudgetMB = std::atol(argv[++i]);
+    else if (std::string(argv[i]) == "-i") maxIterations = std::atoi(argv[++i]);
+    else if (std::string(argv[i]) == "-D") deepZoom = true;
+    else if (std::string(argv[i]) == "-S") seriesApproximation = true;
+    else if (std::string(argv[i]) == "-b") frameList = argv[++i];
+    else if (std::string(argv[i]) == "-e") encodeThreads = std::atoi(argv[++i]);
+    else if (std::string(argv[i]) == "-q") queueDepth = std::atoi(argv[++i]);
   }
 
-  if (useOMP) OMPMandelbrot(width, height, maxIterations, filename);
-  else if (numThreads > 1) parallelMandelbrot(width, height, maxIterations, filename, numThreads);
+  spanKernel = selectMandelbrotKernel(kernelName);
+  std::cout << "Using the " << mandelbrotKernelName(spanKernel) << " kernel\n";
+
+  if (frameList) batchMandelbrot(frameList, maxIterations, numThreads, encodeThreads, queueDepth);
+  else if (frames > 0) zoomSequence(width, height, maxIterations, filename, frames, zoomLevels, cacheBudgetMB << 20);
+  else if (useOMP) OMPMandelbrot(width, height, maxIterations, filename);
+  else if (numThreads > 1) parallelMandelbrot(width, height, maxIterations, filename, numThreads, tileWidth, tileHeight, verbose);
   else serialMandelbrot(width, height, maxIterations, filename);
   
   return 0;
@@ -8,6 +8,9 @@
 #SBATCH -o my_super_job.o
 #SBATCH -e my_super_job.e
 
+# The PNG encoder links against zlib
+g++ -O3 -fopenmp mandelbrot.cc -o a.out -lz || exit 1
+
 run_executable() {
     WIDTH=$1
     HEIGHT=$2
@@ -46,3 +49,20 @@ for HEIGHT in "${HEIGHTS[@]}"; do
     run_executable 480 $HEIGHT 0 4
 done
 
+
+# 4. The width/height sweep again as one pipelined batch: compute on frame k+1
+#    overlaps encoding of frame k, for a few compute/encode thread splits
+FRAME_LIST="sweep_frames.txt"
+: > $FRAME_LIST
+for WIDTH in "${WIDTHS[@]}"; do
+    echo "$WIDTH 480 0 0 4 batch_w${WIDTH}_h480.png" >> $FRAME_LIST
+done
+for HEIGHT in "${HEIGHTS[@]}"; do
+    echo "480 $HEIGHT 0 0 4 batch_w480_h${HEIGHT}.png" >> $FRAME_LIST
+done
+for SPLIT in "3 1" "2 2" "1 3"; do
+    set -- $SPLIT
+    echo "Running batch with COMPUTE_THREADS=$1, ENCODE_THREADS=$2"
+    ./a.out -b $FRAME_LIST -n $1 -e $2 -q 2
+    echo "----------------------------------------"
+done
@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 #include <stdbool.h>
+#include <string.h>
 #include <chrono>
 #include <omp.h>
 
@@ -17,17 +19,6 @@ static double sqrarg;
 #define TINY 1e-20
 #define BIG 1.0e30
 
-double **dmatrix(int nrl, int nrh, int ncl, int nch)
-{
-    double **m;
-    m = (double **)malloc((nrh - nrl + 1) * sizeof(double *));
-    for (int i = 0; i <= nrh - nrl; i++)
-    {
-        m[i] = (double *)malloc((nch - ncl + 1) * sizeof(double));
-    }
-    return m;
-}
-
 double *dvector(int nl, int nh)
 {
     return (double *)malloc((nh - nl + 1) * sizeof(double));
@@ -38,15 +29,6 @@ int *ivector(int nl, int nh)
     return (int *)malloc((nh - nl + 1) * sizeof(int));
 }
 
-void free_dmatrix(double **m, int nrl, int nrh, int ncl, int nch)
-{
-    for (int i = 0; i <= nrh - nrl; i++)
-    {
-        free(m[i]);
-    }
-    free(m);
-}
-
 void free_dvector(double *v, int nl, int nh)
 {
     free(v);
@@ -57,266 +39,927 @@ void free_ivector(int *v, int nl, int nh)
     free(v);
 }
 
-// LU decomposition
-void ludcmp(double **a, int n, int *indx, double *d)
+#define MATRIX_ALIGN 64
+
+// Square matrix in one 64-byte aligned allocation. Rows are padded to whole cache
+// lines, plus one more line when the stride would be a multiple of 4 KiB (walking a
+// column would then alias in L1). Logical row i lives at physical row perm[i], so
+// pivoting swaps two ints instead of two rows. Float matrices exist for the
+// mixed-precision solver; everything else works on Matrix.
+template <typename T>
+struct MatrixOf
 {
-    int i, imax, j, k;
-    double big, dum, sum, temp;
-    double *vv;
+    T *data;
+    int *perm;
+    int n;
+    int ld;
+};
+
+typedef MatrixOf<double> Matrix;
+typedef MatrixOf<float> MatrixF;
+
+template <typename T>
+MatrixOf<T> matrix_of(int n)
+{
+    const int line = MATRIX_ALIGN / sizeof(T);
+    MatrixOf<T> m;
+    m.n = n;
+    m.ld = (n + line - 1) & ~(line - 1);
+    if ((m.ld * sizeof(T)) % 4096 == 0)
+        m.ld += line;
+    m.data = (T *)aligned_alloc(MATRIX_ALIGN, (size_t)n * m.ld * sizeof(T));
+    m.perm = ivector(0, n - 1);
+    for (int i = 0; i < n; i++)
+        m.perm[i] = i;
+    return m;
+}
+
+Matrix matrix(int n)
+{
+    return matrix_of<double>(n);
+}
+
+template <typename T>
+void free_matrix(MatrixOf<T> *m)
+{
+    free(m->data);
+    free_ivector(m->perm, 0, m->n - 1);
+}
+
+template <typename T>
+static inline T *matrix_row(const MatrixOf<T> *m, int i)
+{
+    return m->data + (size_t)m->perm[i] * m->ld;
+}
+
+// Implicit scaling of each row for the pivot search: vv[i] = 1 / max_j |a[i][j]|
+template <typename T>
+static void row_scales(const MatrixOf<T> *a, double *vv, int i)
+{
+    const T *row = matrix_row(a, i);
+    double big = 0.0, temp;
+    for (int j = 0; j < a->n; j++)
+    {
+        if ((temp = fabs(row[j])) > big)
+            big = temp;
+    }
+    if (big == 0.0)
+    {
+        printf("Singular matrix in routine ludcmp\n");
+        exit(1);
+    }
+    vv[i] = 1.0 / big;
+}
+
+// Partial pivoting for column j: picks the row with the largest scaled |a[i][j]|,
+// swaps it into place through the permutation and regularises a tiny pivot
+template <typename T>
+static void choose_pivot(MatrixOf<T> *a, int j, int *indx, double *d, double *vv)
+{
+    int i, imax = j;
+    double big = 0.0, dum;
+    for (i = j; i < a->n; i++)
+    {
+        if ((dum = vv[i] * fabs(matrix_row(a, i)[j])) >= big)
+        {
+            big = dum;
+            imax = i;
+        }
+    }
+    if (j != imax)
+    {
+        int swap = a->perm[imax];
+        a->perm[imax] = a->perm[j];
+        a->perm[j] = swap;
+        *d = -(*d);
+        vv[imax] = vv[j];
+    }
+    indx[j] = imax;
+    T *pivot_row = matrix_row(a, j);
+    if (fabs(pivot_row[j]) < 1e-6)
+    {
+        printf("Zero pivot in ludcmp. Regularizing...\n");
+        pivot_row[j] = 1e-6;
+    }
+}
 
-    vv = dvector(0, n - 1);
+// Column j of L below the pivot, then the rank-1 update of row i's columns up to end;
+// both run along contiguous rows
+template <typename T>
+static inline void eliminate_row(const MatrixOf<T> *a, int j, int i, int end)
+{
+    const T *pivot_row = matrix_row(a, j);
+    T *row = matrix_row(a, i);
+    T l = row[j] /= pivot_row[j];
+#pragma omp simd
+    for (int k = j + 1; k < end; k++)
+        row[k] -= l * pivot_row[k];
+}
+
+// ludcmp with the caller's vv[0..n-1] for the row scales
+static void ludcmp_workspace(Matrix *a, int *indx, double *d, double *vv)
+{
+    int i, j, n = a->n;
     *d = 1.0;
     for (i = 0; i < n; i++)
+        row_scales(a, vv, i);
+    for (j = 0; j < n; j++)
     {
-        big = 0.0;
-        for (j = 0; j < n; j++)
+        choose_pivot(a, j, indx, d, vv);
+        for (i = j + 1; i < n; i++)
+            eliminate_row(a, j, i, n);
+    }
+}
+
+// LU decomposition, right-looking: same implicit-pivoting choices as NR's Crout
+// ludcmp, but each step updates whole trailing rows instead of walking columns
+void ludcmp(Matrix *a, int *indx, double *d)
+{
+    double *vv = dvector(0, a->n - 1);
+    ludcmp_workspace(a, indx, d, vv);
+    free_dvector(vv, 0, a->n - 1);
+}
+
+#define LU_BLOCK 64
+
+// Factors the panel of columns [k0, k1) for every row from k0 down: pivot, scale the L
+// column and update the rest of the panel only. Afterwards the physical rows of
+// logical rows k0..n-1 are final for this step and are saved in rows[].
+template <typename T>
+static void factor_panel(MatrixOf<T> *a, int k0, int k1, int *indx, double *d, double *vv, int *rows)
+{
+    for (int j = k0; j < k1; j++)
+    {
+        choose_pivot(a, j, indx, d, vv);
+        for (int i = j + 1; i < a->n; i++)
+            eliminate_row(a, j, i, k1);
+    }
+    for (int i = k0; i < a->n; i++)
+        rows[i - k0] = a->perm[i];
+}
+
+// Step k's update of column block [c0, c1): the unit lower triangular solve that turns
+// the panel rows into U12, then A22 -= L21 * U12 four rows at a time so every U12 row
+// loaded from cache is used four times. rows[] are the physical rows saved by the panel.
+template <typename T>
+static void update_column_block(const MatrixOf<T> *a, int k0, int k1, int c0, int c1, const int *rows)
+{
+    int nb = k1 - k0, m = a->n - k0, i;
+    T *u[LU_BLOCK];
+    for (i = 0; i < nb; i++)
+        u[i] = a->data + (size_t)rows[i] * a->ld;
+
+    for (i = 1; i < nb; i++)
+    {
+        for (int j = 0; j < i; j++)
         {
-            if ((temp = fabs(a[i][j])) > big)
-                big = temp;
+            T l = u[i][k0 + j];
+#pragma omp simd
+            for (int c = c0; c < c1; c++)
+                u[i][c] -= l * u[j][c];
         }
-        if (big == 0.0)
+    }
+
+    for (i = nb; i + 4 <= m; i += 4)
+    {
+        T *r0 = a->data + (size_t)rows[i] * a->ld, *r1 = a->data + (size_t)rows[i + 1] * a->ld;
+        T *r2 = a->data + (size_t)rows[i + 2] * a->ld, *r3 = a->data + (size_t)rows[i + 3] * a->ld;
+        for (int j = 0; j < nb; j++)
         {
-            printf("Singular matrix in routine ludcmp\n");
-            exit(1);
+            T l0 = r0[k0 + j], l1 = r1[k0 + j], l2 = r2[k0 + j], l3 = r3[k0 + j];
+            const T *uj = u[j];
+#pragma omp simd
+            for (int c = c0; c < c1; c++)
+            {
+                r0[c] -= l0 * uj[c];
+                r1[c] -= l1 * uj[c];
+                r2[c] -= l2 * uj[c];
+                r3[c] -= l3 * uj[c];
+            }
         }
-        vv[i] = 1.0 / big;
     }
-    for (j = 0; j < n; j++)
+    for (; i < m; i++)
     {
-        for (i = 0; i < j; i++)
+        T *r = a->data + (size_t)rows[i] * a->ld;
+        for (int j = 0; j < nb; j++)
         {
-            sum = a[i][j];
-            for (k = 0; k < i; k++)
-                sum -= a[i][k] * a[k][j];
-            a[i][j] = sum;
+            T l = r[k0 + j];
+            const T *uj = u[j];
+#pragma omp simd
+            for (int c = c0; c < c1; c++)
+                r[c] -= l * uj[c];
         }
-        big = 0.0;
-        for (i = j; i < n; i++)
+    }
+}
+
+// Blocked right-looking LU with the same pivots as ludcmp. Every column block has a
+// dependency token: panel k writes token k, and update (k, c) reads token k and writes
+// token c. Panel k+1 therefore only waits for update (k, k+1) and runs while the rest
+// of step k's trailing update is still in flight (lookahead). Pivoting only permutes
+// perm[], and each step works on the physical rows its panel saved, so a later
+// panel's swaps never disturb an update that is still running.
+template <typename T>
+void ludcmp_parallel(MatrixOf<T> *a, int *indx, double *d)
+{
+    int n = a->n, nblocks = (n + LU_BLOCK - 1) / LU_BLOCK;
+    double *vv = dvector(0, n - 1);
+    char *token = (char *)malloc(nblocks);
+    int **rows = (int **)malloc(nblocks * sizeof(int *));
+    for (int k = 0; k < nblocks; k++)
+        rows[k] = ivector(0, n - k * LU_BLOCK - 1);
+    *d = 1.0;
+
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int i = 0; i < n; i++)
+            row_scales(a, vv, i);
+
+#pragma omp single
+        for (int k = 0; k < nblocks; k++)
         {
-            sum = a[i][j];
-            for (k = 0; k < j; k++)
-                sum -= a[i][k] * a[k][j];
-            a[i][j] = sum;
-            if ((dum = vv[i] * fabs(sum)) >= big)
+            int k0 = k * LU_BLOCK, k1 = k0 + LU_BLOCK < n ? k0 + LU_BLOCK : n;
+#pragma omp task depend(inout : token[k])
+            factor_panel(a, k0, k1, indx, d, vv, rows[k]);
+
+            for (int c = k + 1; c < nblocks; c++)
             {
-                big = dum;
-                imax = i;
+                int c0 = c * LU_BLOCK, c1 = c0 + LU_BLOCK < n ? c0 + LU_BLOCK : n;
+#pragma omp task depend(in : token[k]) depend(inout : token[c])
+                update_column_block(a, k0, k1, c0, c1, rows[k]);
             }
         }
-        if (j != imax)
+    }
+
+    for (int k = 0; k < nblocks; k++)
+        free_ivector(rows[k], 0, n - k * LU_BLOCK - 1);
+    free(rows);
+    free(token);
+    free_dvector(vv, 0, n - 1);
+}
+
+// backsubstitution; b stays double when the factors are float
+template <typename T>
+void lubksb(const MatrixOf<T> *a, int *indx, double b[])
+{
+    int i, ii = -1, ip, j, n = a->n;
+    double sum;
+
+    // ii is the first nonzero entry of b (NR's 1-based code uses 0 for "none yet")
+    for (i = 0; i < n; i++)
+    {
+        const T *row = matrix_row(a, i);
+        ip = indx[i];
+        sum = b[ip];
+        b[ip] = b[i];
+        if (ii >= 0)
+            for (j = ii; j < i; j++)
+                sum -= row[j] * b[j];
+        else if (sum)
+            ii = i;
+        b[i] = sum;
+    }
+    for (i = n - 1; i >= 0; i--)
+    {
+        const T *row = matrix_row(a, i);
+        sum = b[i];
+        for (j = i + 1; j < n; j++)
+            sum -= row[j] * b[j];
+        b[i] = sum / row[i];
+    }
+}
+
+#define SOLVE_BLOCK 128
+#define RHS_BLOCK 64
+
+// b_rows -= L or U block (rows [i0, i1), columns [j0, j1)) * b[j0..j1), on right-hand
+// side columns [c0, c1). A single column is a dot product per row; otherwise each
+// solved row of b is streamed across the columns, four target rows at a time.
+static void solve_update(const Matrix *a, double *b, int ldb, int i0, int i1, int j0, int j1, int c0, int c1)
+{
+    int i = i0;
+    if (c1 - c0 == 1)
+    {
+        for (; i < i1; i++)
         {
-            for (k = 0; k < n; k++)
+            const double *row = matrix_row(a, i);
+            double sum = 0.0;
+#pragma omp simd reduction(+ : sum)
+            for (int j = j0; j < j1; j++)
+                sum += row[j] * b[(size_t)j * ldb + c0];
+            b[(size_t)i * ldb + c0] -= sum;
+        }
+        return;
+    }
+    for (; i + 4 <= i1; i += 4)
+    {
+        const double *a0 = matrix_row(a, i), *a1 = matrix_row(a, i + 1), *a2 = matrix_row(a, i + 2), *a3 = matrix_row(a, i + 3);
+        double *b0 = b + (size_t)i * ldb, *b1 = b0 + ldb, *b2 = b1 + ldb, *b3 = b2 + ldb;
+        for (int j = j0; j < j1; j++)
+        {
+            const double *bj = b + (size_t)j * ldb;
+            double l0 = a0[j], l1 = a1[j], l2 = a2[j], l3 = a3[j];
+#pragma omp simd
+            for (int c = c0; c < c1; c++)
             {
-                dum = a[imax][k];
-                a[imax][k] = a[j][k];
-                a[j][k] = dum;
+                b0[c] -= l0 * bj[c];
+                b1[c] -= l1 * bj[c];
+                b2[c] -= l2 * bj[c];
+                b3[c] -= l3 * bj[c];
             }
-            *d = -(*d);
-            vv[imax] = vv[j];
         }
-        indx[j] = imax;
-        if (fabs(a[j][j]) < 1e-6)
+    }
+    for (; i < i1; i++)
+    {
+        const double *row = matrix_row(a, i);
+        double *bi = b + (size_t)i * ldb;
+        for (int j = j0; j < j1; j++)
         {
-            printf("Zero pivot in ludcmp. Regularizing...\n");
-            a[j][j] = 1e-6;
+            const double *bj = b + (size_t)j * ldb;
+            double l = row[j];
+#pragma omp simd
+            for (int c = c0; c < c1; c++)
+                bi[c] -= l * bj[c];
         }
     }
-    free_dvector(vv, 0, n - 1);
 }
 
-void ludcmp_parallel(double **a, int n, int *indx, double *d)
+// Triangular solve of the diagonal block [i0, i1) on columns [c0, c1): unit lower for the
+// forward pass, upper with the division by the pivot for the backward pass
+static void solve_diagonal(const Matrix *a, double *b, int ldb, int i0, int i1, int c0, int c1, bool upper)
 {
-    int i, imax, j, k;
-    double big, dum, sum, temp;
-    double *vv = dvector(0, n-1);
-    *d = 1.0;
+    if (!upper)
+    {
+        for (int i = i0 + 1; i < i1; i++)
+            solve_update(a, b, ldb, i, i + 1, i0, i, c0, c1);
+        return;
+    }
+    for (int i = i1 - 1; i >= i0; i--)
+    {
+        solve_update(a, b, ldb, i, i + 1, i + 1, i1, c0, c1);
+        double inv = 1.0 / matrix_row(a, i)[i];
+        double *bi = b + (size_t)i * ldb;
+        for (int c = c0; c < c1; c++)
+            bi[c] *= inv;
+    }
+}
 
-#pragma omp parallel for private(i, j, big, temp)
-    for (i = 0; i < n; i++)
+// Solves A X = B for nrhs right-hand sides against one ludcmp factorisation. B is
+// n x nrhs, row-major with row stride ldb, and is overwritten by X. Both passes are
+// blocked by SOLVE_BLOCK rows and RHS_BLOCK columns, with one dependency token per
+// (row block, column block). Diagonal solve (k, c) writes token (k, c); update (k, i, c)
+// reads it and writes token (i, c). A row block starts as soon as the blocks it depends
+// on are solved, every trailing update runs in parallel, and column blocks are
+// independent of each other throughout.
+void lubksb_multi(const Matrix *a, int *indx, double *b, int nrhs, int ldb)
+{
+    int n = a->n;
+    int nrb = (n + SOLVE_BLOCK - 1) / SOLVE_BLOCK, ncb = (nrhs + RHS_BLOCK - 1) / RHS_BLOCK;
+    char *token = (char *)malloc((size_t)nrb * ncb);
+
+#pragma omp parallel
     {
-        big = 0.0;
-        for (j = 0; j < n; j++)
+        // the row swaps are applied in order, each thread on its own column block
+#pragma omp for
+        for (int c = 0; c < ncb; c++)
         {
-            if ((temp = fabs(a[i][j])) > big)
-                big = temp;
+            int c0 = c * RHS_BLOCK, c1 = c0 + RHS_BLOCK < nrhs ? c0 + RHS_BLOCK : nrhs;
+            for (int i = 0; i < n; i++)
+            {
+                if (indx[i] == i)
+                    continue;
+                double *bi = b + (size_t)i * ldb, *bp = b + (size_t)indx[i] * ldb;
+                for (int k = c0; k < c1; k++)
+                {
+                    double swap = bi[k];
+                    bi[k] = bp[k];
+                    bp[k] = swap;
+                }
+            }
         }
-        if (big == 0.0)
+
+#pragma omp single
+        for (int pass = 0; pass < 2; pass++)
         {
-            printf("Singular matrix in routine ludcmp\n");
-            exit(1);
+            bool upper = pass == 1;
+            for (int step = 0; step < nrb; step++)
+            {
+                int k = upper ? nrb - 1 - step : step;
+                int k0 = k * SOLVE_BLOCK, k1 = k0 + SOLVE_BLOCK < n ? k0 + SOLVE_BLOCK : n;
+                for (int c = 0; c < ncb; c++)
+                {
+                    int c0 = c * RHS_BLOCK, c1 = c0 + RHS_BLOCK < nrhs ? c0 + RHS_BLOCK : nrhs;
+#pragma omp task depend(inout : token[k * ncb + c])
+                    solve_diagonal(a, b, ldb, k0, k1, c0, c1, upper);
+
+                    for (int other = step + 1; other < nrb; other++)
+                    {
+                        int i = upper ? nrb - 1 - other : other;
+                        int i0 = i * SOLVE_BLOCK, i1 = i0 + SOLVE_BLOCK < n ? i0 + SOLVE_BLOCK : n;
+#pragma omp task depend(in : token[k * ncb + c]) depend(inout : token[i * ncb + c])
+                        solve_update(a, b, ldb, i0, i1, k0, k1, c0, c1);
+                    }
+                }
+            }
         }
-        vv[i] = 1.0 / big;
     }
 
-    for (j = 0; j < n; j++)
+    free(token);
+}
+
+void lubksb_parallel(const Matrix *a, int *indx, double b[])
+{
+    lubksb_multi(a, indx, b, 1, 1);
+}
+
+// Structure detection for the fast solver path. One O(n^2) scan finds the lower and
+// upper bandwidth, whether A is Toeplitz and the largest off-diagonal entry; a second
+// one checks whether the off-diagonal part of A is rank 1, a_ij = u_i v_j for i != j
+// (then A = diag(a_ii - u_i v_i) + u v^T, diagonal plus rank 1).
+enum MatrixStructure
+{
+    STRUCTURE_GENERAL,
+    STRUCTURE_DIAGONAL_PLUS_RANK1,
+    STRUCTURE_BANDED,
+    STRUCTURE_TOEPLITZ
+};
+
+struct StructureInfo
+{
+    MatrixStructure kind;
+    int lower, upper;  // bandwidths
+};
+
+// Recovers u and v with a_ij = u_i v_j for every i != j from the largest off-diagonal
+// entry a_pq: u is column q, v is row p scaled by 1 / a_pq, and the two entries they
+// miss (u_q and v_p) come from the row and column of the largest remaining v_j and
+// u_i, or from a_qp = u_q v_p when those are all zero. Every off-diagonal entry is
+// then checked against u_i v_j.
+static bool offdiagonal_rank1(const Matrix *a, int p, int q, double u[], double v[])
+{
+    int n = a->n;
+    const double *pivot_row = matrix_row(a, p);
+    double pivot = pivot_row[q];
+    for (int i = 0; i < n; i++)
+    {
+        u[i] = i == q ? 0.0 : matrix_row(a, i)[q];
+        v[i] = i == p ? 0.0 : pivot_row[i] / pivot;
+    }
+    int jmax = -1, imax = -1;
+    for (int k = 0; k < n; k++)
+    {
+        if (k == p || k == q)
+            continue;
+        if (v[k] != 0.0 && (jmax < 0 || fabs(v[k]) > fabs(v[jmax])))
+            jmax = k;
+        if (u[k] != 0.0 && (imax < 0 || fabs(u[k]) > fabs(u[imax])))
+            imax = k;
+    }
+    if (jmax >= 0)
+        u[q] = matrix_row(a, q)[jmax] / v[jmax];
+    if (imax >= 0)
+        v[p] = matrix_row(a, imax)[p] / u[imax];
+    double opposite = matrix_row(a, q)[p];
+    if (jmax < 0 && imax < 0)
+    {
+        u[q] = opposite;
+        v[p] = 1.0;
+    }
+    else if (jmax < 0 && v[p] != 0.0)
+        u[q] = opposite / v[p];
+    else if (imax < 0 && u[q] != 0.0)
+        v[p] = opposite / u[q];
+
+    // u_i v_j carries a few roundings of entries no larger than the pivot
+    double tolerance = 16 * DBL_EPSILON * fabs(pivot);
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = matrix_row(a, i);
+        for (int j = 0; j < n; j++)
+            if (i != j && fabs(row[j] - u[i] * v[j]) > tolerance)
+                return false;
+    }
+    return true;
+}
+
+// Classifies A; for diagonal plus rank 1 the factors are left in u[0..n-1] and v[0..n-1]
+StructureInfo detect_structure(const Matrix *a, double u[], double v[])
+{
+    int n = a->n, p = -1, q = -1;
+    StructureInfo info;
+    info.lower = info.upper = 0;
+    bool toeplitz = true;
+    double largest = 0.0;
+    for (int i = 0; i < n; i++)
     {
-#pragma omp parallel for private(i, sum, k)
-        for (i = 0; i < j; i++)
+        const double *row = matrix_row(a, i), *above = i > 0 ? matrix_row(a, i - 1) : NULL;
+        for (int j = 0; j < n; j++)
         {
-            sum = a[i][j];
-#pragma omp simd reduction(- : sum)
-            for (k = 0; k < i; k++)
+            if (row[j] != 0.0)
+            {
+                if (i - j > info.lower)
+                    info.lower = i - j;
+                if (j - i > info.upper)
+                    info.upper = j - i;
+            }
+            if (i != j && fabs(row[j]) > largest)
             {
-                sum -= a[i][k] * a[k][j];
+                largest = fabs(row[j]);
+                p = i;
+                q = j;
             }
-            a[i][j] = sum;
+            if (above && j > 0 && row[j] != above[j - 1])
+                toeplitz = false;
         }
+    }
+    if (p >= 0 && offdiagonal_rank1(a, p, q, u, v))
+        info.kind = STRUCTURE_DIAGONAL_PLUS_RANK1;
+    else if (8 * (info.lower + info.upper + 1) <= n)
+        info.kind = STRUCTURE_BANDED;
+    else if (toeplitz)
+        info.kind = STRUCTURE_TOEPLITZ;
+    else
+        info.kind = STRUCTURE_GENERAL;
+    return info;
+}
 
-        big = 0.0;
+// Sherman-Morrison for (D + u v^T) x = b with D = diag(a_ii - u_i v_i), in O(n):
+// x = D^-1 b - (v^T D^-1 b) / (1 + v^T D^-1 u) D^-1 u.
+// Returns false when D or the denominator is (numerically) singular.
+bool sherman_morrison(const Matrix *a, const double u[], const double v[], double b[])
+{
+    int n = a->n;
+    double *z = dvector(0, n - 1);
+    double sum_y = 0.0, sum_z = 0.0;
+    bool ok = true;
+    for (int i = 0; i < n; i++)
+    {
+        double diagonal = matrix_row(a, i)[i] - u[i] * v[i];
+        if (diagonal == 0.0)
+        {
+            ok = false;
+            break;
+        }
+        z[i] = u[i] / diagonal;
+        b[i] /= diagonal;
+        sum_y += v[i] * b[i];
+        sum_z += v[i] * z[i];
+    }
+    double denominator = 1.0 + sum_z;
+    if (ok && fabs(denominator) > 1e-12 * (1.0 + fabs(sum_z)))
+    {
+        double scale = sum_y / denominator;
+        for (int i = 0; i < n; i++)
+            b[i] -= scale * z[i];
+    }
+    else
+        ok = false;
+    free_dvector(z, 0, n - 1);
+    return ok;
+}
 
-#pragma omp parallel for private(i, sum, k, dum) reduction(max : big)
-        for (i = j; i < n; i++)
+// Band LU with the implicit-scaling partial pivoting of ludcmp, LAPACK gbtrf style:
+// rows are swapped physically and only from the pivot column on, so each multiplier
+// stays where it was computed and lubksb_banded can replay the swaps as it goes.
+// Fill-in widens U to lower + upper, so one step touches lower x (lower + upper) entries.
+void ludcmp_banded(Matrix *a, int lower, int upper, int *indx, double *d)
+{
+    int n = a->n, width = lower + upper;
+    double *vv = dvector(0, n - 1);
+    *d = 1.0;
+    for (int i = 0; i < n; i++)
+        row_scales(a, vv, i);
+    for (int j = 0; j < n; j++)
+    {
+        int last = j + lower < n - 1 ? j + lower : n - 1, end = j + width + 1 < n ? j + width + 1 : n;
+        int imax = j;
+        double big = 0.0, dum;
+        for (int i = j; i <= last; i++)
         {
-            sum = a[i][j];
-#pragma omp simd reduction(- : sum)
-            for (k = 0; k < j; k++)
-            {
-                sum -= a[i][k] * a[k][j];
-            }
-            a[i][j] = sum;
-            if ((dum = vv[i] * fabs(sum)) >= big)
+            if ((dum = vv[i] * fabs(matrix_row(a, i)[j])) >= big)
             {
                 big = dum;
                 imax = i;
             }
         }
-
-        if (j != imax)
+        double *pivot_row = matrix_row(a, j);
+        if (imax != j)
         {
-#pragma omp parallel for private(k, dum)
-            for (k = 0; k < n; k++)
+            double *other = matrix_row(a, imax);
+            for (int k = j; k < end; k++)
             {
-                dum = a[imax][k];
-                a[imax][k] = a[j][k];
-                a[j][k] = dum;
+                dum = pivot_row[k];
+                pivot_row[k] = other[k];
+                other[k] = dum;
             }
             *d = -(*d);
             vv[imax] = vv[j];
         }
-
         indx[j] = imax;
-
-        if (fabs(a[j][j]) < 1e-6)
+        if (fabs(pivot_row[j]) < 1e-6)
         {
             printf("Zero pivot in ludcmp. Regularizing...\n");
-            a[j][j] = 1e-6;
+            pivot_row[j] = 1e-6;
+        }
+        for (int i = j + 1; i <= last; i++)
+        {
+            double *row = matrix_row(a, i);
+            double l = row[j] /= pivot_row[j];
+#pragma omp simd
+            for (int k = j + 1; k < end; k++)
+                row[k] -= l * pivot_row[k];
         }
     }
-
-    free_dvector(vv, 0, n-1);
+    free_dvector(vv, 0, n - 1);
 }
 
-// backsubstitution
-void lubksb(double **a, int n, int *indx, double b[])
+void lubksb_banded(const Matrix *a, int lower, int upper, int *indx, double b[])
 {
-    int i, ii = 0, ip, j;
-    double sum;
+    int n = a->n, width = lower + upper;
+    for (int j = 0; j < n; j++)
+    {
+        double swap = b[indx[j]];
+        b[indx[j]] = b[j];
+        b[j] = swap;
+        int last = j + lower < n - 1 ? j + lower : n - 1;
+        for (int i = j + 1; i <= last; i++)
+            b[i] -= matrix_row(a, i)[j] * b[j];
+    }
+    for (int i = n - 1; i >= 0; i--)
+    {
+        const double *row = matrix_row(a, i);
+        int end = i + width + 1 < n ? i + width + 1 : n;
+        double sum = b[i];
+        for (int k = i + 1; k < end; k++)
+            sum -= row[k] * b[k];
+        b[i] = sum / row[i];
+    }
+}
 
-    for (i = 0; i < n; i++)
+// Levinson recursion for a general Toeplitz system (NR's toeplz, indices shifted to
+// 0-based): r[n - 1 + i - j] = a[i][j]. O(n^2); returns false when a leading principal
+// minor is singular, which the recursion cannot pass.
+bool toeplz(const double r[], double x[], const double y[], int n)
+{
+    const double *rr = r - 1;  // NR's 1-based r[1..2n-1]
+    if (n < 1 || rr[n] == 0.0)
+        return false;
+    double *g = dvector(0, n), *h = dvector(0, n);
+    bool ok = true;
+    x[0] = y[0] / rr[n];
+    if (n > 1)
     {
-        ip = indx[i];
-        sum = b[ip];
-        b[ip] = b[i];
-        if (ii)
-            for (j = ii; j < i; j++)
-                sum -= a[i][j] * b[j];
-        else if (sum)
-            ii = i;
-        b[i] = sum;
+        g[1] = rr[n - 1] / rr[n];
+        h[1] = rr[n + 1] / rr[n];
     }
-    for (i = n - 1; i >= 0; i--)
+    for (int m = 1; m < n; m++)
     {
-        sum = b[i];
-        for (j = i + 1; j < n; j++)
-            sum -= a[i][j] * b[j];
-        b[i] = sum / a[i][i];
+        int m1 = m + 1;
+        double sxn = -y[m1 - 1], sd = -rr[n];
+        for (int j = 1; j <= m; j++)
+        {
+            sxn += rr[n + m1 - j] * x[j - 1];
+            sd += rr[n + m1 - j] * g[m - j + 1];
+        }
+        if (sd == 0.0)
+        {
+            ok = false;
+            break;
+        }
+        x[m1 - 1] = sxn / sd;
+        for (int j = 1; j <= m; j++)
+            x[j - 1] -= x[m1 - 1] * g[m - j + 1];
+        if (m1 == n)
+            break;
+        double sgn = -rr[n - m1], shn = -rr[n + m1], sgd = -rr[n];
+        for (int j = 1; j <= m; j++)
+        {
+            sgn += rr[n + j - m1] * g[j];
+            shn += rr[n + m1 - j] * h[j];
+            sgd += rr[n + j - m1] * h[m - j + 1];
+        }
+        if (sgd == 0.0)
+        {
+            ok = false;
+            break;
+        }
+        g[m1] = sgn / sgd;
+        h[m1] = shn / sd;
+        int k = m;
+        double pp = g[m1], qq = h[m1];
+        for (int j = 1; j <= (m + 1) >> 1; j++, k--)
+        {
+            double pt1 = g[j], pt2 = g[k], qt1 = h[j], qt2 = h[k];
+            g[j] = pt1 - pp * qt2;
+            g[k] = pt2 - pp * qt1;
+            h[j] = qt1 - qq * pt2;
+            h[k] = qt2 - qq * pt1;
+        }
     }
+    free_dvector(g, 0, n);
+    free_dvector(h, 0, n);
+    return ok;
 }
 
-void lubksb_parallel(double **a, int n, int *indx, double b[])
+// Levinson has no pivoting, so its answer is only kept if max |Ax - b| is small
+// relative to max |b|
+static bool toeplitz_solve(const Matrix *a, double b[])
 {
-    int i, ii = -1, ip, j;
-    double sum;
+    int n = a->n;
+    double *r = dvector(0, 2 * n - 2), *x = dvector(0, n - 1);
+    r[n - 1] = matrix_row(a, 0)[0];
+    for (int k = 1; k < n; k++)
+    {
+        r[n - 1 + k] = matrix_row(a, k)[0];
+        r[n - 1 - k] = matrix_row(a, 0)[k];
+    }
+    bool ok = toeplz(r, x, b, n);
+    if (ok)
+    {
+        double worst = 0.0, largest = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            const double *row = matrix_row(a, i);
+            double sum = -b[i];
+            for (int j = 0; j < n; j++)
+                sum += row[j] * x[j];
+            if (!(fabs(sum) <= worst))
+                worst = fabs(sum);  // keeps a NaN, which fmax would drop
+            largest = fmax(largest, fabs(b[i]));
+        }
+        ok = worst <= 1e-12 * largest;
+    }
+    if (ok)
+        for (int i = 0; i < n; i++)
+            b[i] = x[i];
+    free_dvector(r, 0, 2 * n - 2);
+    free_dvector(x, 0, n - 1);
+    return ok;
+}
 
-#pragma omp parallel for private(i, ip, sum)
-    for (i = 0; i < n; i++)
+// Solves A x = b (x overwrites b) with the cheapest solver the structure of A allows,
+// falling back to the blocked LU; returns the name of the solver that was used
+const char *solve_structured(Matrix *a, double b[], int *indx, double *d)
+{
+    double *u = dvector(0, a->n - 1), *v = dvector(0, a->n - 1);
+    StructureInfo info = detect_structure(a, u, v);
+    bool solved = false;
+    *d = 1.0;
+    if (info.kind == STRUCTURE_DIAGONAL_PLUS_RANK1)
     {
-        ip = indx[i];
-        sum = b[ip];
-        b[ip] = b[i];
-        b[i] = sum;
+        // Sherman-Morrison scales b in place, so keep a copy for the fallback
+        double *copy = dvector(0, a->n - 1);
+        for (int i = 0; i < a->n; i++)
+            copy[i] = b[i];
+        solved = sherman_morrison(a, u, v, b);
+        if (!solved)
+            for (int i = 0; i < a->n; i++)
+                b[i] = copy[i];
+        free_dvector(copy, 0, a->n - 1);
+    }
+    free_dvector(u, 0, a->n - 1);
+    free_dvector(v, 0, a->n - 1);
+    if (solved)
+        return "Sherman-Morrison (diagonal plus rank 1)";
+    if (info.kind == STRUCTURE_BANDED)
+    {
+        ludcmp_banded(a, info.lower, info.upper, indx, d);
+        lubksb_banded(a, info.lower, info.upper, indx, b);
+        return "banded LU";
     }
+    else if (info.kind == STRUCTURE_TOEPLITZ && toeplitz_solve(a, b))
+    {
+        return "Levinson (Toeplitz)";
+    }
+    ludcmp_parallel(a, indx, d);
+    lubksb_parallel(a, indx, b);
+    return "general LU";
+}
 
-#pragma omp parallel
+#define MAX_REFINEMENTS 30
+
+// r = b - A x in double against the original matrix; returns ||r||_inf and leaves
+// ||x||_inf in xnorm
+static double residual(const Matrix *a, const double b[], const double x[], double r[], double *xnorm)
+{
+    int n = a->n;
+    double rnorm = 0.0, xmax = 0.0;
+#pragma omp parallel for schedule(static) reduction(max : rnorm, xmax)
+    for (int i = 0; i < n; i++)
     {
-        int local_ii = -1;
+        const double *row = matrix_row(a, i);
+        double sum = b[i];
+        for (int j = 0; j < n; j++)
+            sum -= row[j] * x[j];
+        r[i] = sum;
+        rnorm = fmax(rnorm, fabs(sum));
+        xmax = fmax(xmax, fabs(x[i]));
+    }
+    *xnorm = xmax;
+    return rnorm;
+}
 
-#pragma omp for private(i, j, sum)
-        for (i = 0; i < n; i++)
-        {
-            sum = b[i];
-            if (local_ii >= 0)
-            {
-#pragma omp simd reduction(- : sum)
-                for (j = local_ii; j < i; j++)
-                {
-                    sum -= a[i][j] * b[j];
-                }
-            }
-            else if (sum != 0.0)
-            {
-                local_ii = i;
-            }
-            b[i] = sum;
-        }
-#pragma omp critical
-        if (local_ii != -1 && (ii == -1 || local_ii < ii))
+// Mixed-precision solve of A x = b. A float copy of A goes through the blocked LU
+// (half the memory traffic and twice the SIMD width of double), then iterative
+// refinement in double: r = b - A x, solve with the float factors, x += correction,
+// until the normwise backward error ||r|| / (||A|| ||x|| + ||b||) is within tolerance.
+// A step that fails to halve the residual means refinement has stalled (A is too
+// ill-conditioned for float), and x is recomputed with the double LU. Returns the
+// number of refinement steps, or -1 after the fallback; error gets the final
+// backward error.
+int lusolve_mixed(const Matrix *a, const double b[], double x[], double tolerance, double *error)
+{
+    int n = a->n, iterations = 0, *indx = ivector(0, n - 1);
+    double d, anorm = 0.0, bnorm = 0.0, xnorm, rnorm, previous = BIG;
+    double *r = dvector(0, n - 1);
+    MatrixF af = matrix_of<float>(n);
+
+#pragma omp parallel for schedule(static) reduction(max : anorm, bnorm)
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = matrix_row(a, i);
+        float *rowf = matrix_row(&af, i);
+        double sum = 0.0;
+        for (int j = 0; j < n; j++)
         {
-            ii = local_ii;
+            rowf[j] = (float)row[j];
+            sum += fabs(row[j]);
         }
+        anorm = fmax(anorm, sum);
+        bnorm = fmax(bnorm, fabs(b[i]));
     }
 
-#pragma omp parallel for private(i, j, sum)
-    for (i = n - 1; i >= 0; i--)
+    ludcmp_parallel(&af, indx, &d);
+    for (int i = 0; i < n; i++)
+        x[i] = b[i];
+    lubksb(&af, indx, x);
+
+    while ((rnorm = residual(a, b, x, r, &xnorm)) > tolerance * (anorm * xnorm + bnorm))
     {
-        sum = b[i];
-#pragma omp simd reduction(- : sum)
-        for (j = i + 1; j < n; j++)
+        if (iterations == MAX_REFINEMENTS || !(rnorm < 0.5 * previous))
         {
-            sum -= a[i][j] * b[j];
+            Matrix alu = matrix(n);
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; i++)
+                memcpy(matrix_row(&alu, i), matrix_row(a, i), n * sizeof(double));
+            ludcmp_parallel(&alu, indx, &d);
+            for (int i = 0; i < n; i++)
+                x[i] = b[i];
+            lubksb(&alu, indx, x);
+            free_matrix(&alu);
+            rnorm = residual(a, b, x, r, &xnorm);
+            iterations = -1;
+            break;
         }
-        b[i] = sum / a[i][i];
+        previous = rnorm;
+        lubksb(&af, indx, r);
+        for (int i = 0; i < n; i++)
+            x[i] += r[i];
+        iterations++;
     }
+    *error = rnorm / (anorm * xnorm + bnorm);
+
+    free_matrix(&af);
+    free_dvector(r, 0, n - 1);
+    free_ivector(indx, 0, n - 1);
+    return iterations;
+}
+
+// Pade system: diagonal 1 + 0.1 j, 0.1 everywhere else, right-hand side 0.1 (j + 1)
+static void pade_row(Matrix *a, double *b, int j)
+{
+    double *row = matrix_row(a, j);
+    for (int k = 0; k < a->n; k++)
+    {
+        row[k] = (j == k) ? (1.0 + j * 0.1) : 0.1;
+    }
+    b[j] = 0.1 * (j + 1);
 }
 
 // Serial Pade approximation function
 void serial_pade(double cof[], int n, double *resid)
 {
-    int j, k, *indx;
-    double **a, *b;
+    int j, *indx;
+    double *b;
+    Matrix a = matrix(n);
 
-    a = dmatrix(0, n - 1, 0, n - 1);
     b = dvector(0, n - 1);
     indx = ivector(0, n - 1);
 
     for (j = 0; j < n; j++)
     {
-        for (k = 0; k < n; k++)
-        {
-            a[j][k] = (j == k) ? (1.0 + j * 0.1) : 0.1;
-        }
-        b[j] = 0.1 * (j + 1);
+        pade_row(&a, b, j);
     }
 
-    ludcmp(a, n, indx, resid);
-    lubksb(a, n, indx, b);
+    ludcmp(&a, indx, resid);
+    lubksb(&a, indx, b);
 
     for (int i = 0; i < n; i++)
     {
         cof[i] = b[i];
     }
 
-    free_dmatrix(a, 0, n - 1, 0, n - 1);
+    free_matrix(&a);
     free_dvector(b, 0, n - 1);
     free_ivector(indx, 0, n - 1);
 }
@@ -324,38 +967,478 @@ void serial_pade(double cof[], int n, double *resid)
 // Parallel Pade approximation function with OpenMP
 void parallel_pade(double cof[], int n, double *resid)
 {
-    // your code here
-    // you can copy the serial code from serial_pade and parallelize it
-    // remember to call parallel versions of ludcmp and lubksb
-    int i, j, k, *indx;
-    double **a, *b;
+    int j, *indx;
+    double *b;
+    Matrix a = matrix(n);
 
-    a = dmatrix(0, n - 1, 0, n - 1);
     b = dvector(0, n - 1);
     indx = ivector(0, n - 1);
 
-#pragma omp parallel for private(j, k)
-    for (i = 0; i < n * n; i++)
+    // rows are first touched by the threads that will update them
+#pragma omp parallel for schedule(static)
+    for (j = 0; j < n; j++)
     {
-        j = i / n;
-        k = i % n;
+        pade_row(&a, b, j);
+    }
+
+    ludcmp_parallel(&a, indx, resid);
+    lubksb_parallel(&a, indx, b);
+
+    for (int i = 0; i < n; i++)
+    {
+        cof[i] = b[i];
+    }
+
+    free_matrix(&a);
+    free_dvector(b, 0, n - 1);
+    free_ivector(indx, 0, n - 1);
+}
+
+// Pade approximation through the structure-detecting solver
+const char *structured_pade(double cof[], int n, double *resid)
+{
+    int j, *indx;
+    double *b;
+    Matrix a = matrix(n);
 
-        a[j][k] = (j == k) ? (1.0 + j * 0.1) : 0.1;
+    b = dvector(0, n - 1);
+    indx = ivector(0, n - 1);
 
-        b[j] = 0.1 * (j + 1);
+#pragma omp parallel for schedule(static)
+    for (j = 0; j < n; j++)
+    {
+        pade_row(&a, b, j);
     }
 
-    ludcmp_parallel(a, n, indx, resid);
-    lubksb_parallel(a, n, indx, b);
+    const char *solver = solve_structured(&a, b, indx, resid);
 
     for (int i = 0; i < n; i++)
     {
         cof[i] = b[i];
     }
 
-    free_dmatrix(a, 0, n - 1, 0, n - 1);
+    free_matrix(&a);
+    free_dvector(b, 0, n - 1);
+    free_ivector(indx, 0, n - 1);
+    return solver;
+}
+
+// Pade approximation through the mixed-precision solver; returns its refinement steps
+int mixed_pade(double cof[], int n, double tolerance, double *error)
+{
+    int j;
+    double *b;
+    Matrix a = matrix(n);
+
+    b = dvector(0, n - 1);
+
+#pragma omp parallel for schedule(static)
+    for (j = 0; j < n; j++)
+    {
+        pade_row(&a, b, j);
+    }
+
+    int iterations = lusolve_mixed(&a, b, cof, tolerance, error);
+
+    free_matrix(&a);
     free_dvector(b, 0, n - 1);
+    return iterations;
+}
+
+#define BATCH_LANES 8
+
+// Many independent small systems A_s x_s = b_s in two 64-byte aligned allocations.
+// Contiguous: each system's n x n matrix row-major, one after another. Interleaved:
+// systems in groups of BATCH_LANES with entry (i, j) of every system in a group side
+// by side, so each SIMD lane carries one system; the last group is padded with
+// identity systems. Interleaved is the default: for small n it is the faster of the two.
+struct SystemBatch
+{
+    double *a;
+    double *b;
+    int n;
+    int count;
+    int padded;
+    bool interleaved;
+};
+
+static inline size_t batch_index(const SystemBatch *batch, int s, size_t k, size_t len)
+{
+    if (!batch->interleaved)
+        return (size_t)s * len + k;
+    return ((size_t)(s / BATCH_LANES) * len + k) * BATCH_LANES + s % BATCH_LANES;
+}
+
+static inline double *batch_entry(const SystemBatch *batch, int s, int i, int j)
+{
+    return batch->a + batch_index(batch, s, (size_t)i * batch->n + j, (size_t)batch->n * batch->n);
+}
+
+static inline double *batch_rhs(const SystemBatch *batch, int s, int i)
+{
+    return batch->b + batch_index(batch, s, i, batch->n);
+}
+
+// Systems per unit of work: solve_batch hands whole units to threads, a single system
+// when contiguous and a group of BATCH_LANES systems when interleaved
+static inline int batch_unit(const SystemBatch *batch)
+{
+    return batch->interleaved ? BATCH_LANES : 1;
+}
+
+// aligned_alloc wants a whole number of alignment units
+static double *aligned_dvector(size_t count)
+{
+    size_t bytes = (count * sizeof(double) + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+    return (double *)aligned_alloc(MATRIX_ALIGN, bytes);
+}
+
+SystemBatch system_batch(int n, int count, bool interleaved = true)
+{
+    SystemBatch batch;
+    batch.n = n;
+    batch.count = count;
+    batch.interleaved = interleaved;
+    batch.padded = interleaved ? (count + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES : count;
+    batch.a = aligned_dvector((size_t)batch.padded * n * n);
+    batch.b = aligned_dvector((size_t)batch.padded * n);
+
+    // First touch with solve_batch's schedule, so each unit's pages are local to the
+    // thread that later fills and solves it
+    int unit = batch_unit(&batch);
+#pragma omp parallel for schedule(static)
+    for (int u = 0; u < batch.padded / unit; u++)
+    {
+        memset(batch.a + (size_t)u * unit * n * n, 0, (size_t)unit * n * n * sizeof(double));
+        memset(batch.b + (size_t)u * unit * n, 0, (size_t)unit * n * sizeof(double));
+    }
+    for (int s = count; s < batch.padded; s++)
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+                *batch_entry(&batch, s, i, j) = (i == j);
+            *batch_rhs(&batch, s, i) = 0.0;
+        }
+    return batch;
+}
+
+void free_system_batch(SystemBatch *batch)
+{
+    free(batch->a);
+    free(batch->b);
+}
+
+// Scratch a thread allocates once and reuses for every system it solves
+struct BatchArena
+{
+    double *vv;
+    int *perm;
+    int *indx;
+};
+
+static BatchArena batch_arena(int n)
+{
+    BatchArena arena;
+    arena.vv = dvector(0, n * BATCH_LANES - 1);
+    arena.perm = ivector(0, n - 1);
+    arena.indx = ivector(0, n - 1);
+    return arena;
+}
+
+static void free_batch_arena(BatchArena *arena, int n)
+{
+    free_dvector(arena->vv, 0, n * BATCH_LANES - 1);
+    free_ivector(arena->perm, 0, n - 1);
+    free_ivector(arena->indx, 0, n - 1);
+}
+
+// Contiguous system s: ludcmp and lubksb on a Matrix view of it, with the arena
+// supplying the permutation, pivots and row scales
+static void solve_contiguous(SystemBatch *batch, int s, BatchArena *arena)
+{
+    int n = batch->n;
+    double d;
+    Matrix m;
+    m.data = batch->a + (size_t)s * n * n;
+    m.perm = arena->perm;
+    m.n = n;
+    m.ld = n;
+    for (int i = 0; i < n; i++)
+        m.perm[i] = i;
+    ludcmp_workspace(&m, arena->indx, &d, arena->vv);
+    lubksb(&m, arena->indx, batch->b + (size_t)s * n);
+}
+
+// Interleaved group g, one system per SIMD lane. Same scaled partial pivoting as
+// ludcmp, but as pivots differ between lanes each lane swaps its own pivot row (and
+// right-hand side entry) in place; the forward substitution is fused into the
+// elimination and the back substitution follows.
+static void solve_interleaved(SystemBatch *batch, int g, BatchArena *arena)
+{
+    const int L = BATCH_LANES;
+    int n = batch->n;
+    double *a = batch->a + (size_t)g * n * n * L, *b = batch->b + (size_t)g * n * L, *vv = arena->vv;
+
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = a + (size_t)i * n * L;
+        double big[L] = {0.0};
+        for (int j = 0; j < n; j++)
+#pragma omp simd
+            for (int l = 0; l < L; l++)
+            {
+                double v = fabs(row[j * L + l]);
+                big[l] = v > big[l] ? v : big[l];
+            }
+        for (int l = 0; l < L; l++)
+        {
+            if (big[l] == 0.0)
+            {
+                printf("Singular matrix in routine ludcmp\n");
+                exit(1);
+            }
+            vv[i * L + l] = 1.0 / big[l];
+        }
+    }
+
+    for (int j = 0; j < n; j++)
+    {
+        // the pivot row is tracked as a double so the search is a single-width select
+        double *pivot = a + (size_t)j * n * L, big[L] = {0.0}, best[L];
+        for (int l = 0; l < L; l++)
+            best[l] = j;
+        for (int i = j; i < n; i++)
+        {
+            const double *column = a + ((size_t)i * n + j) * L;
+#pragma omp simd
+            for (int l = 0; l < L; l++)
+            {
+                double dum = vv[i * L + l] * fabs(column[l]);
+                best[l] = dum >= big[l] ? i : best[l];
+                big[l] = dum >= big[l] ? dum : big[l];
+            }
+        }
+        int imax[L];
+        for (int l = 0; l < L; l++)
+            imax[l] = (int)best[l];
+        for (int l = 0; l < L; l++)
+        {
+            if (imax[l] != j)
+            {
+                double *other = a + (size_t)imax[l] * n * L, swap;
+                for (int k = 0; k < n; k++)
+                {
+                    swap = pivot[k * L + l];
+                    pivot[k * L + l] = other[k * L + l];
+                    other[k * L + l] = swap;
+                }
+                swap = b[j * L + l];
+                b[j * L + l] = b[imax[l] * L + l];
+                b[imax[l] * L + l] = swap;
+                vv[imax[l] * L + l] = vv[j * L + l];
+            }
+            if (fabs(pivot[j * L + l]) < 1e-6)
+            {
+                printf("Zero pivot in ludcmp. Regularizing...\n");
+                pivot[j * L + l] = 1e-6;
+            }
+        }
+        for (int i = j + 1; i < n; i++)
+        {
+            double *row = a + (size_t)i * n * L;
+#pragma omp simd
+            for (int l = 0; l < L; l++)
+            {
+                row[j * L + l] /= pivot[j * L + l];
+                b[i * L + l] -= row[j * L + l] * b[j * L + l];
+            }
+        }
+        // trailing update four rows at a time, so each pivot row load feeds four rows
+        int i = j + 1;
+        for (; i + 3 < n; i += 4)
+        {
+            double *r0 = a + (size_t)i * n * L, *r1 = r0 + n * L, *r2 = r1 + n * L, *r3 = r2 + n * L;
+            for (int k = j + 1; k < n; k++)
+#pragma omp simd
+                for (int l = 0; l < L; l++)
+                {
+                    double p = pivot[k * L + l];
+                    r0[k * L + l] -= r0[j * L + l] * p;
+                    r1[k * L + l] -= r1[j * L + l] * p;
+                    r2[k * L + l] -= r2[j * L + l] * p;
+                    r3[k * L + l] -= r3[j * L + l] * p;
+                }
+        }
+        for (; i < n; i++)
+        {
+            double *row = a + (size_t)i * n * L;
+            for (int k = j + 1; k < n; k++)
+#pragma omp simd
+                for (int l = 0; l < L; l++)
+                    row[k * L + l] -= row[j * L + l] * pivot[k * L + l];
+        }
+    }
+
+    for (int i = n - 1; i >= 0; i--)
+    {
+        const double *row = a + (size_t)i * n * L;
+        for (int k = i + 1; k < n; k++)
+#pragma omp simd
+            for (int l = 0; l < L; l++)
+                b[i * L + l] -= row[k * L + l] * b[k * L + l];
+#pragma omp simd
+        for (int l = 0; l < L; l++)
+            b[i * L + l] /= row[i * L + l];
+    }
+}
+
+// Factors and solves every system in place, b_s becoming x_s. Systems (or groups of
+// BATCH_LANES when interleaved) are split across threads with no parallelism inside a
+// system, and each thread allocates a single arena for all of its systems.
+void solve_batch(SystemBatch *batch)
+{
+#pragma omp parallel
+    {
+        BatchArena arena = batch_arena(batch->n);
+        if (batch->interleaved)
+        {
+#pragma omp for schedule(static)
+            for (int g = 0; g < batch->padded / BATCH_LANES; g++)
+                solve_interleaved(batch, g, &arena);
+        }
+        else
+        {
+#pragma omp for schedule(static)
+            for (int s = 0; s < batch->count; s++)
+                solve_contiguous(batch, s, &arena);
+        }
+        free_batch_arena(&arena, batch->n);
+    }
+}
+
+// Fills every system of the batch with the Pade system of pade_row, unit by unit with
+// solve_batch's schedule
+void pade_batch(SystemBatch *batch)
+{
+    int n = batch->n, unit = batch_unit(batch);
+#pragma omp parallel for schedule(static)
+    for (int u = 0; u < batch->padded / unit; u++)
+        for (int s = u * unit; s < std::min((u + 1) * unit, batch->count); s++)
+            for (int j = 0; j < n; j++)
+            {
+                for (int k = 0; k < n; k++)
+                    *batch_entry(batch, s, j, k) = (j == k) ? (1.0 + j * 0.1) : 0.1;
+                *batch_rhs(batch, s, j) = 0.1 * (j + 1);
+            }
+}
+
+// One step of iterative improvement (NR's mprove): r = A x - b with the original
+// matrix, solve LU d = r with the factorised copy, x -= d
+void mprove(const Matrix *a, const Matrix *alud, int *indx, const double b[], double x[])
+{
+    int n = a->n;
+    double *r = dvector(0, n - 1);
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = matrix_row(a, i);
+        long double sdp = -b[i];
+        for (int j = 0; j < n; j++)
+            sdp += (long double)row[j] * x[j];
+        r[i] = (double)sdp;
+    }
+    lubksb(alud, indx, r);
+    for (int i = 0; i < n; i++)
+        x[i] -= r[i];
+    free_dvector(r, 0, n - 1);
+}
+
+// Pade approximation (NR's pade). On input cof[0..2n] are power-series coefficients;
+// on output cof[0..n] are the numerator coefficients and cof[n+1..2n] the denominator
+// coefficients b_1..b_n (b_0 = 1). The denominator solves the Toeplitz system
+// sum_k cof[n + j - k] x_k = cof[n + j], j, k = 1..n, by Levinson recursion; when the
+// recursion breaks down or its residual is poor, LU with iterative improvement
+// takes over. resid is the 2-norm of the final Toeplitz residual. Returns the solver used.
+const char *pade(double cof[], int n, double *resid)
+{
+    int *indx = ivector(0, n - 1);
+    double *x = dvector(0, n - 1), *y = dvector(0, n - 1);
+    Matrix q = matrix(n), qlu = matrix(n);
+    const char *solver = "Levinson (Toeplitz)";
+
+    for (int j = 0; j < n; j++)
+    {
+        y[j] = x[j] = cof[n + j + 1];
+        for (int k = 0; k < n; k++)
+            matrix_row(&q, j)[k] = matrix_row(&qlu, j)[k] = cof[j - k + n];
+    }
+
+    if (!toeplitz_solve(&q, x))
+    {
+        double d, rr = BIG, rrold;
+        double *z = dvector(0, n - 1);
+        solver = "LU with iterative improvement";
+        ludcmp(&qlu, indx, &d);
+        lubksb(&qlu, indx, x);
+        do
+        {
+            rrold = rr;
+            for (int j = 0; j < n; j++)
+                z[j] = x[j];
+            mprove(&q, &qlu, indx, y, x);
+            rr = 0.0;
+            for (int j = 0; j < n; j++)
+                rr += SQR(z[j] - x[j]);
+        } while (rr < rrold);
+        free_dvector(z, 0, n - 1);
+    }
+
+    double rr = 0.0;
+    for (int j = 0; j < n; j++)
+    {
+        const double *row = matrix_row(&q, j);
+        double sum = -y[j];
+        for (int k = 0; k < n; k++)
+            sum += row[k] * x[k];
+        rr += SQR(sum);
+    }
+    *resid = sqrt(rr);
+
+    for (int k = 1; k <= n; k++)
+    {
+        double sum = cof[k];
+        for (int j = 1; j <= k; j++)
+            sum -= x[j - 1] * cof[k - j];
+        y[k - 1] = sum;
+    }
+    for (int j = 1; j <= n; j++)
+    {
+        cof[j] = y[j - 1];
+        cof[j + n] = -x[j - 1];
+    }
+
+    free_matrix(&q);
+    free_matrix(&qlu);
+    free_dvector(x, 0, n - 1);
+    free_dvector(y, 0, n - 1);
     free_ivector(indx, 0, n - 1);
+    return solver;
+}
+
+// Evaluates the approximant pade() left in cof at count points: Horner in numerator
+// and denominator. The points are independent, so the loop is split across threads and
+// each thread's share runs SIMD lanes over consecutive points.
+void pade_evaluate(const double cof[], int n, const double x[], double y[], int count)
+{
+#pragma omp parallel for simd schedule(static)
+    for (int i = 0; i < count; i++)
+    {
+        double num = cof[n], den = cof[2 * n];
+        for (int k = n - 1; k >= 0; k--)
+            num = num * x[i] + cof[k];
+        for (int k = 2 * n - 1; k > n; k--)
+            den = den * x[i] + cof[k];
+        y[i] = num / (den * x[i] + 1.0);
+    }
 }
 
 // Compare serial and parallel results
@@ -373,11 +1456,162 @@ bool check_results(double *serial_results, double *parallel_results, int size)
     return match;
 }
 
+// Solves nrhs right-hand sides against one factorisation of the Pade matrix, once
+// with lubksb_multi and once as nrhs separate lubksb calls
+void multi_rhs_benchmark(int n, int nrhs)
+{
+    int *indx = ivector(0, n - 1);
+    double *b = dvector(0, n - 1), *x = dvector(0, n - 1), d;
+    double *rhs = dvector(0, n * nrhs - 1);
+    Matrix a = matrix(n);
+
+    for (int j = 0; j < n; j++)
+    {
+        pade_row(&a, b, j);
+        for (int r = 0; r < nrhs; r++)
+            rhs[j * nrhs + r] = b[j] * (r + 1) + 0.01 * ((j + r) % 7);
+    }
+    ludcmp_parallel(&a, indx, &d);
+
+    auto start_looped = std::chrono::high_resolution_clock::now();
+    double *looped = dvector(0, n * nrhs - 1);
+    for (int r = 0; r < nrhs; r++)
+    {
+        for (int j = 0; j < n; j++)
+            x[j] = rhs[j * nrhs + r];
+        lubksb(&a, indx, x);
+        for (int j = 0; j < n; j++)
+            looped[j * nrhs + r] = x[j];
+    }
+    auto end_looped = std::chrono::high_resolution_clock::now();
+
+    auto start_multi = std::chrono::high_resolution_clock::now();
+    lubksb_multi(&a, indx, rhs, nrhs, nrhs);
+    auto end_multi = std::chrono::high_resolution_clock::now();
+
+    double worst = 0.0, largest = 0.0;
+    for (int k = 0; k < n * nrhs; k++)
+    {
+        worst = fmax(worst, fabs(rhs[k] - looped[k]));
+        largest = fmax(largest, fabs(looped[k]));
+    }
+    std::chrono::duration<double> looped_time = end_looped - start_looped, multi_time = end_multi - start_multi;
+    printf("Multi-RHS solve (%d right-hand sides): %.6f seconds, looped lubksb: %.6f seconds, max relative difference %.3e\n",
+           nrhs, multi_time.count(), looped_time.count(), worst / largest);
+
+    free_matrix(&a);
+    free_dvector(looped, 0, n * nrhs - 1);
+    free_dvector(rhs, 0, n * nrhs - 1);
+    free_dvector(x, 0, n - 1);
+    free_dvector(b, 0, n - 1);
+    free_ivector(indx, 0, n - 1);
+}
+
+#define BATCH_REPEATS 5
+
+// Throughput of count independent n x n Pade systems: a loop over serial_pade against
+// solve_batch with each layout. The batch is allocated and first-touched once; every
+// timing covers filling and solving the systems, as serial_pade does, and the best of
+// BATCH_REPEATS runs is reported for each.
+void batch_benchmark(int n, int count)
+{
+    double *reference = dvector(0, (size_t)n * count - 1), resid, loop_time = 1e30;
+    for (int r = 0; r < BATCH_REPEATS; r++)
+    {
+        auto start_loop = std::chrono::high_resolution_clock::now();
+        for (int s = 0; s < count; s++)
+            serial_pade(reference + (size_t)s * n, n, &resid);
+        auto end_loop = std::chrono::high_resolution_clock::now();
+        loop_time = fmin(loop_time, std::chrono::duration<double>(end_loop - start_loop).count());
+    }
+    printf("serial_pade loop (n=%d, %d systems): %.6f seconds, %.3e systems/s\n", n, count, loop_time,
+           count / loop_time);
+
+    for (int interleaved = 0; interleaved <= 1; interleaved++)
+    {
+        auto start_alloc = std::chrono::high_resolution_clock::now();
+        SystemBatch batch = system_batch(n, count, interleaved);
+        auto end_alloc = std::chrono::high_resolution_clock::now();
+        double alloc_time = std::chrono::duration<double>(end_alloc - start_alloc).count();
+        double batch_time = 1e30, solve_time = 1e30;
+        for (int r = 0; r < BATCH_REPEATS; r++)
+        {
+            auto start_batch = std::chrono::high_resolution_clock::now();
+            pade_batch(&batch);
+            auto start_solve = std::chrono::high_resolution_clock::now();
+            solve_batch(&batch);
+            auto end_batch = std::chrono::high_resolution_clock::now();
+            batch_time = fmin(batch_time, std::chrono::duration<double>(end_batch - start_batch).count());
+            solve_time = fmin(solve_time, std::chrono::duration<double>(end_batch - start_solve).count());
+        }
+
+        double worst = 0.0;
+        for (int s = 0; s < count; s++)
+            for (int i = 0; i < n; i++)
+                worst = fmax(worst, fabs(*batch_rhs(&batch, s, i) - reference[(size_t)s * n + i]));
+        printf("Batched solve (%s, n=%d, %d systems): %.6f seconds (solve %.6f, one-off allocation %.6f), "
+               "%.3e systems/s, %.2fx the loop, max difference %.3e\n",
+               interleaved ? "interleaved" : "contiguous", n, count, batch_time, solve_time, alloc_time,
+               count / batch_time, loop_time / batch_time, worst);
+        free_system_batch(&batch);
+    }
+    free_dvector(reference, 0, (size_t)n * count - 1);
+}
+
+// Builds the [n/n] Pade approximant of exp from its Taylor series and times the
+// vectorised evaluator against libm over points spread across [-1, 1]
+void approximation_demo(int n, int points)
+{
+    double *cof = dvector(0, 2 * n), resid, factorial = 1.0;
+    for (int k = 0; k <= 2 * n; k++)
+    {
+        cof[k] = 1.0 / factorial;
+        factorial *= k + 1;
+    }
+    const char *solver = pade(cof, n, &resid);
+    printf("Pade [%d/%d] of exp via %s, residual %.3e\n", n, n, solver, resid);
+
+    double *x = dvector(0, points - 1), *y = dvector(0, points - 1), *reference = dvector(0, points - 1);
+    for (int i = 0; i < points; i++)
+        x[i] = -1.0 + 2.0 * i / (points > 1 ? points - 1 : 1);
+
+    auto start_pade = std::chrono::high_resolution_clock::now();
+    pade_evaluate(cof, n, x, y, points);
+    auto end_pade = std::chrono::high_resolution_clock::now();
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < points; i++)
+        reference[i] = exp(x[i]);
+    auto end_libm = std::chrono::high_resolution_clock::now();
+
+    double worst = 0.0;
+    for (int i = 0; i < points; i++)
+        worst = fmax(worst, fabs(y[i] - reference[i]) / reference[i]);
+    std::chrono::duration<double> pade_time = end_pade - start_pade, libm_time = end_libm - end_pade;
+    printf("Evaluated %d points in %.6f seconds (%.3e points/s), max relative error %.3e; libm exp: %.6f seconds\n",
+           points, pade_time.count(), points / pade_time.count(), worst, libm_time.count());
+
+    free_dvector(cof, 0, 2 * n);
+    free_dvector(x, 0, points - 1);
+    free_dvector(y, 0, points - 1);
+    free_dvector(reference, 0, points - 1);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    if (argc == 4 && strcmp(argv[1], "approx") == 0)
+    {
+        approximation_demo(atoi(argv[2]), atoi(argv[3]));
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "batch") == 0)
     {
-        printf("Usage: %s <n>\n", argv[0]);
+        batch_benchmark(atoi(argv[2]), atoi(argv[3]));
+        return 0;
+    }
+    if (argc != 2 && argc != 3)
+    {
+        printf("Usage: %s <n> [right-hand sides]\n       %s approx <order> <points>\n       %s batch <n> <systems>\n",
+               argv[0], argv[0], argv[0]);
         return 1;
     }
 
@@ -389,10 +1623,12 @@ int main(int argc, char *argv[])
     }
 
     double resid;
-    double *c_serial, *c_parallel;
+    double *c_serial, *c_parallel, *c_structured, *c_mixed;
 
     c_serial = dvector(0, n - 1);
     c_parallel = dvector(0, n - 1);
+    c_structured = dvector(0, n - 1);
+    c_mixed = dvector(0, n - 1);
 
     auto start_serial = std::chrono::high_resolution_clock::now();
     serial_pade(c_serial, n, &resid);
@@ -404,6 +1640,17 @@ int main(int argc, char *argv[])
     auto end_parallel = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> parallel_time = end_parallel - start_parallel;
 
+    auto start_structured = std::chrono::high_resolution_clock::now();
+    const char *solver = structured_pade(c_structured, n, &resid);
+    auto end_structured = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> structured_time = end_structured - start_structured;
+
+    double error;
+    auto start_mixed = std::chrono::high_resolution_clock::now();
+    int refinements = mixed_pade(c_mixed, n, 1e-15, &error);
+    auto end_mixed = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> mixed_time = end_mixed - start_mixed;
+
     if (check_results(c_serial, c_parallel, n))
     {
         printf("The serial and parallel results match.\n");
@@ -416,7 +1663,24 @@ int main(int argc, char *argv[])
     printf("Serial time: %.6f seconds\n", serial_time.count());
     printf("Parallel time: %.6f seconds\n", parallel_time.count());
 
+    printf("Structured solver: %s, %s the general LU result\n", solver,
+           check_results(c_serial, c_structured, n) ? "matches" : "does not match");
+    printf("Structured time: %.6f seconds\n", structured_time.count());
+
+    if (refinements < 0)
+        printf("Mixed precision: refinement stalled, fell back to double LU, backward error %.3e, %s the general LU result\n",
+               error, check_results(c_serial, c_mixed, n) ? "matches" : "does not match");
+    else
+        printf("Mixed precision: %d refinement steps, backward error %.3e, %s the general LU result\n", refinements,
+               error, check_results(c_serial, c_mixed, n) ? "matches" : "does not match");
+    printf("Mixed time: %.6f seconds\n", mixed_time.count());
+
+    if (argc == 3)
+        multi_rhs_benchmark(n, atoi(argv[2]));
+
     free_dvector(c_serial, 0, n - 1);
     free_dvector(c_parallel, 0, n - 1);
+    free_dvector(c_structured, 0, n - 1);
+    free_dvector(c_mixed, 0, n - 1);
     return 0;
 }
\ No newline at end of file
@@ -22,16 +22,20 @@ run_executable() {
     # Extract serial and parallel times using pattern matching
     serial_time=$(echo "$output" | grep -oP 'Serial time: \K[\d.]+')
     parallel_time=$(echo "$output" | grep -oP 'Parallel time: \K[\d.]+')
+    structured_time=$(echo "$output" | grep -oP 'Structured time: \K[\d.]+')
+    mixed_time=$(echo "$output" | grep -oP 'Mixed time: \K[\d.]+')
 
     # Log the results
-    echo "$INPUT_SIZE, $NUM_THREADS, $serial_time, $parallel_time" >> performance_data.csv
-    echo "Serial time: $serial_time, Parallel time: $parallel_time"
+    echo "$INPUT_SIZE, $NUM_THREADS, $serial_time, $parallel_time, $structured_time, $mixed_time" >> performance_data.csv
+    echo "Serial time: $serial_time, Parallel time: $parallel_time, Structured time: $structured_time, Mixed time: $mixed_time"
+    echo "$output" | grep "Structured solver"
+    echo "$output" | grep "Mixed precision"
     echo "----------------------------------------"
 }
 
 # Remove previous performance data
 rm -f performance_data.csv
-echo "InputSize, NumThreads, SerialTime, ParallelTime" > performance_data.csv
+echo "InputSize, NumThreads, SerialTime, ParallelTime, StructuredTime, MixedTime" > performance_data.csv
 
 # Arrays for varying parameters
 INPUT_SIZES=(10 100 500 1000 2000 3000 4000)
@@ -43,3 +47,25 @@ for SIZE in "${INPUT_SIZES[@]}"; do
         run_executable $SIZE $THREADS
     done
 done
+
+# Many right-hand sides against one factorisation: lubksb_multi vs. a loop of lubksb
+export OMP_NUM_THREADS=20
+for RHS in 1 10 100 500; do
+    echo "Running with INPUT_SIZE=2000, RIGHT_HAND_SIDES=$RHS"
+    ./a.out 2000 $RHS | grep "Multi-RHS"
+    echo "----------------------------------------"
+done
+
+# [n/n] Pade approximants of exp built from the Taylor series, evaluated over 10^8 points
+for ORDER in 4 8 12; do
+    echo "Running with ORDER=$ORDER"
+    ./a.out approx $ORDER 100000000
+    echo "----------------------------------------"
+done
+
+# Tens of thousands of independent small Pade systems: batched solver vs. a loop of serial_pade
+for SIZE in 8 16 32 64 128; do
+    echo "Running with BATCH_N=$SIZE, SYSTEMS=20000"
+    ./a.out batch $SIZE 20000
+    echo "----------------------------------------"
+done
@@ -4,65 +4,249 @@
 #include <bits/stdc++.h>
 #include <chrono>
 #include <omp.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
-typedef struct
+// Graph in compressed sparse row form: the nodes that node i points to are
+// to[offsets[i]] .. to[offsets[i + 1] - 1], so the out-degree is offsets[i + 1] - offsets[i].
+// Offsets are 32-bit unless the number of edges needs 64.
+template <typename Index>
+struct CSR
 {
-    int outd; // Number of outgoing edges (out-degree)
-    int *to;  // Array of nodes this node points to
-} Node;
+    Index *offsets; // N + 1 entries
+    int *to;        // One entry per edge
+    double *weight; // Edge weights in the same order as to, NULL when the input has none
+};
+
+// Binary graph file: this header, then offsets[nodes + 1], to[edges] and, for weighted graphs,
+// weight[edges], each array padded with zeros to a multiple of 8 bytes. The checksum covers
+// everything after the header.
+struct Graph_Header
+{
+    char magic[8];     // GRAPH_MAGIC
+    uint32_t version;  // GRAPH_VERSION
+    uint32_t flags;    // GRAPH_64BIT_OFFSETS, GRAPH_WEIGHTED
+    uint64_t nodes;
+    uint64_t edges;
+    uint64_t checksum;
+};
+
+const char GRAPH_MAGIC[8] = "PRGRAPH";
+const uint32_t GRAPH_VERSION = 1;
+const uint32_t GRAPH_64BIT_OFFSETS = 1;
+const uint32_t GRAPH_WEIGHTED = 2;
+
+// A binary graph file mapped read-only into memory
+struct Graph_File
+{
+    const char *data;
+    size_t size;
+    Graph_Header header;
+};
+
+// Edges parsed from one newline-aligned piece of the input file
+struct Edge_Chunk
+{
+    vector<int> src, dst;
+    vector<double> weight; // Only filled for the edgelist format
+    int max_id = -1;
+};
 
 int N, threads;
+bool pull;    // Pull rank along in-edges instead of pushing it along out-edges
 double d, threshold;
 double *ri, *rj;
 vector<double> times;
-Node *Nodes;
+vector<Edge_Chunk> chunks; // Edge list as read from the file, freed once the CSR is built
 
-// Function to read the graph from a file
-void Read_Graph(char *filename, int mode)
+// Function to parse a non-negative integer at p; values beyond INT_MAX come back as INT_MAX + 1
+static inline const char *Parse_Int(const char *p, const char *end, long long *value)
 {
-    ifstream file(filename);
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        v = min(v * 10 + (*p++ - '0'), (long long)INT_MAX + 1);
+    }
+    *value = v;
+    return p;
+}
 
-    // Reading edge list from the file (node1 -> node2)
-    // For reading the edgelist format
-    if (mode == 0)
+// Function to parse the lines in [p, end): "node1 node2", followed in the edgelist format by
+// "{'weight':w}". Blank lines and lines starting with # are skipped.
+void Parse_Chunk(const char *p, const char *end, int mode, Edge_Chunk *chunk)
+{
+    while (p < end)
     {
-        int node1, node2, size;
-        string weight;
-        while (file >> node1 >> node2 >> weight)
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+
+        if (p < end && *p >= '0' && *p <= '9')
         {
-            Nodes[node1].outd++;
-            size = Nodes[node1].outd;
-            Nodes[node1].to = (int *)realloc(Nodes[node1].to, size * sizeof(int));
-            Nodes[node1].to[size - 1] = node2;
+            long long node1, node2;
+            p = Parse_Int(p, end, &node1);
+            while (p < end && (*p == ' ' || *p == '\t'))
+                p++;
+            if (p < end && *p >= '0' && *p <= '9')
+            {
+                p = Parse_Int(p, end, &node2);
+                // Ids must stay below INT_MAX so that N = largest id + 1 still fits an int
+                if (node1 >= INT_MAX || node2 >= INT_MAX)
+                {
+                    fprintf(stderr, "Node id too large for int in the input (ids must be below %d)\n", INT_MAX);
+                    exit(1);
+                }
+                chunk->src.push_back(node1);
+                chunk->dst.push_back(node2);
+                chunk->max_id = max(chunk->max_id, (int)max(node1, node2));
+
+                if (mode == 0)
+                {
+                    // The weight follows the ':' of {'weight':w}; it is copied out so strtod stops inside the line
+                    double weight = 1.0;
+                    const char *eol = (const char *)memchr(p, '\n', end - p);
+                    const char *colon = (const char *)memchr(p, ':', (eol ? eol : end) - p);
+                    if (colon)
+                    {
+                        char number[64];
+                        size_t length = min((size_t)((eol ? eol : end) - colon - 1), sizeof(number) - 1);
+                        memcpy(number, colon + 1, length);
+                        number[length] = '\0';
+                        weight = strtod(number, NULL);
+                    }
+                    chunk->weight.push_back(weight);
+                }
+            }
         }
+
+        // Skip the rest of the line
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        p = eol ? eol + 1 : end;
+    }
+}
+
+// Function to renumber the node ids that occur in the edge list densely as 0 .. N - 1, keeping their order
+void Remap_Ids()
+{
+    vector<int> ids;
+    for (auto &chunk : chunks)
+    {
+        ids.insert(ids.end(), chunk.src.begin(), chunk.src.end());
+        ids.insert(ids.end(), chunk.dst.begin(), chunk.dst.end());
     }
-    // For reading the txt format
-    else if (mode == 1)
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (size_t c = 0; c < chunks.size(); c++)
     {
-        string line;
-        while (getline(file, line))
+        for (size_t e = 0; e < chunks[c].src.size(); e++)
         {
-            if (line.empty() || line[0] == '#')
-                continue;
+            chunks[c].src[e] = lower_bound(ids.begin(), ids.end(), chunks[c].src[e]) - ids.begin();
+            chunks[c].dst[e] = lower_bound(ids.begin(), ids.end(), chunks[c].dst[e]) - ids.begin();
+        }
+    }
+    N = ids.size();
+}
 
-            int node1, node2, size;
-            istringstream iss(line);
-            if (iss >> node1 >> node2)
-            {
-                Nodes[node1].outd++;
-                size = Nodes[node1].outd;
-                Nodes[node1].to = (int *)realloc(Nodes[node1].to, size * sizeof(int));
-                Nodes[node1].to[size - 1] = node2;
-            }
+// Function to read the graph from a file (node1 -> node2 per line; mode 0 = edgelist with weights,
+// mode 1 = txt). The file is mapped into memory and cut into one newline-aligned chunk per thread,
+// and the chunks are parsed in parallel. N grows to cover the largest node id in the file; with
+// remap the ids are renumbered densely instead.
+void Read_Graph(char *filename, int mode, bool remap)
+{
+    auto start = chrono::high_resolution_clock::now();
+
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        fprintf(stderr, "Cannot open %s\n", filename);
+        exit(1);
+    }
+    size_t size = st.st_size;
+    const char *data = NULL;
+    if (size > 0)
+    {
+        data = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            fprintf(stderr, "Cannot map %s\n", filename);
+            exit(1);
         }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+
+    // Chunk k starts after the first newline at or past k * size / threads
+    chunks.assign(threads, Edge_Chunk());
+    vector<size_t> bounds(threads + 1, size);
+    bounds[0] = 0;
+    for (int k = 1; k < threads; k++)
+    {
+        size_t from = max(bounds[k - 1], (size_t)k * size / threads);
+        const char *eol = from < size ? (const char *)memchr(data + from, '\n', size - from) : NULL;
+        bounds[k] = eol ? eol - data + 1 : size;
+    }
+
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int k = 0; k < threads; k++)
+    {
+        Parse_Chunk(data + bounds[k], data + bounds[k + 1], mode, &chunks[k]);
+    }
+
+    if (size > 0)
+        munmap((void *)data, size);
+    close(fd);
+
+    size_t edges = 0;
+    int max_id = -1;
+    for (auto &chunk : chunks)
+    {
+        edges += chunk.src.size();
+        max_id = max(max_id, chunk.max_id);
+    }
+    if (remap)
+    {
+        Remap_Ids();
+    }
+    else if (max_id >= N)
+    {
+        if (N > 0)
+            printf("Node id %d does not fit N = %d, using N = %d\n", max_id, N, max_id + 1);
+        N = max_id + 1;
+    }
+    if (N == 0)
+    {
+        fprintf(stderr, "No nodes in %s\n", filename);
+        exit(1);
     }
 
-    file.close();
+    auto end = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration<double>(end - start).count();
+    printf("Nodes = %d, Edges = %zu, Parse Time = %f (%.1f MB/s)\n", N, edges, seconds, size / seconds / (1 << 20));
+}
 
-    // Initialize the rank vectors
-    ri = (double *)malloc(N * sizeof(double));
-    rj = (double *)malloc(N * sizeof(double));
+// Function to allocate count elements of T, exiting with a message when they do not fit in memory
+template <typename T>
+T *Alloc(size_t count, bool zero = false)
+{
+    T *p = (T *)(zero ? calloc(count, sizeof(T)) : malloc(count * sizeof(T)));
+    if (p == NULL && count > 0)
+    {
+        fprintf(stderr, "Out of memory allocating %zu MB for N = %d\n", count * sizeof(T) >> 20, N);
+        exit(1);
+    }
+    return p;
+}
+
+// Function to allocate and initialize the rank vectors
+void Init_Ranks()
+{
+    ri = Alloc<double>(N);
+    rj = Alloc<double>(N);
 
     // Initialize rank vectors: ri starts as all zeros, rj is 1/N for all nodes
 #pragma omp parallel for num_threads(threads)
@@ -73,6 +257,307 @@ void Read_Graph(char *filename, int mode)
     }
 }
 
+// Function to turn per-part degree histograms into CSR offsets: count[p * N + v] holds the edges of
+// node v found by part p and becomes the first slot of v's range that part p writes, after the
+// slots of parts 0..p-1. Each part can then scatter its edges in order with count[p * N + v]++,
+// without atomics, and the result does not depend on the thread count.
+template <typename Index>
+void Scan_Counts(Index *count, int parts, Index *offsets)
+{
+#pragma omp parallel for num_threads(threads) schedule(static)
+    for (int v = 0; v < N; v++)
+    {
+        Index sum = 0;
+        for (int p = 0; p < parts; p++)
+        {
+            Index c = count[(size_t)p * N + v];
+            count[(size_t)p * N + v] = sum;
+            sum += c;
+        }
+        offsets[v + 1] = sum;
+    }
+
+    offsets[0] = 0;
+    for (int v = 0; v < N; v++)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+
+#pragma omp parallel for num_threads(threads) schedule(static)
+    for (int v = 0; v < N; v++)
+    {
+        for (int p = 0; p < parts; p++)
+            count[(size_t)p * N + v] += offsets[v];
+    }
+}
+
+// Function to split the nodes of g into parts ranges [part[t], part[t + 1]) holding about the same
+// number of edges plus nodes
+template <typename Index>
+vector<int> Split_Nodes(const CSR<Index> &g, int parts)
+{
+    vector<int> part(parts + 1, N);
+    double work = (double)g.offsets[N] + N;
+    part[0] = 0;
+    for (int t = 1; t < parts; t++)
+    {
+        // First node whose cumulative work offsets[v] + v reaches t / parts of the total
+        int lo = part[t - 1], hi = N;
+        while (lo < hi)
+        {
+            int mid = lo + (hi - lo) / 2;
+            if ((double)g.offsets[mid] + mid < work * t / parts)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        part[t] = lo;
+    }
+    return part;
+}
+
+// Function to build the CSR graph from the edge list in two passes: every chunk counts the
+// out-degrees of its own edges, the counts are scanned into offsets and per-chunk slots, then
+// every chunk scatters its edges into its slots. Edges keep their order in the file.
+template <typename Index>
+CSR<Index> Build_CSR()
+{
+    size_t edges = 0;
+    bool weighted = false;
+    for (auto &chunk : chunks)
+    {
+        edges += chunk.src.size();
+        weighted |= !chunk.weight.empty();
+    }
+    CSR<Index> g;
+    g.offsets = Alloc<Index>((size_t)N + 1, true);
+    g.to = Alloc<int>(edges);
+    g.weight = weighted ? Alloc<double>(edges) : NULL;
+
+    // Pass 1: chunk c counts the out-degree of node i into count[c * N + i]
+    int parts = chunks.size();
+    Index *count = Alloc<Index>((size_t)parts * N, true);
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int c = 0; c < parts; c++)
+    {
+        Index *own = count + (size_t)c * N;
+        for (int node : chunks[c].src)
+            own[node]++;
+    }
+    Scan_Counts(count, parts, g.offsets);
+
+    // Pass 2: each chunk writes its edges into its own slots, in file order
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int c = 0; c < parts; c++)
+    {
+        const Edge_Chunk &chunk = chunks[c];
+        Index *next = count + (size_t)c * N;
+        for (size_t e = 0; e < chunk.src.size(); e++)
+        {
+            Index slot = next[chunk.src[e]]++;
+            g.to[slot] = chunk.dst[e];
+            if (weighted)
+                g.weight[slot] = chunk.weight[e];
+        }
+    }
+    free(count);
+
+    vector<Edge_Chunk>().swap(chunks);
+    return g;
+}
+
+// Function to free a CSR graph built by Build_CSR
+template <typename Index>
+void Free_CSR(CSR<Index> &g)
+{
+    free(g.offsets);
+    free(g.to);
+    free(g.weight);
+}
+
+// Function to build the transposed graph (in-edges: the nodes pointing to node v are
+// from.to[from.offsets[v]] .. from.to[from.offsets[v + 1] - 1]) with the same two passes as Build_CSR,
+// one part per range of source nodes. Parts scatter in ascending source order, so every in-edge
+// list comes out sorted.
+template <typename Index>
+CSR<Index> Transpose(const CSR<Index> &g)
+{
+    Index edges = g.offsets[N];
+    CSR<Index> t;
+    t.offsets = Alloc<Index>((size_t)N + 1, true);
+    t.to = Alloc<int>(edges);
+    t.weight = NULL;
+
+    // Pass 1: part p counts the in-degree of node v from its sources into count[p * N + v]
+    vector<int> part = Split_Nodes(g, threads);
+    Index *count = Alloc<Index>((size_t)threads * N, true);
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int p = 0; p < threads; p++)
+    {
+        Index *own = count + (size_t)p * N;
+        for (Index j = g.offsets[part[p]]; j < g.offsets[part[p + 1]]; j++)
+            own[g.to[j]]++;
+    }
+    Scan_Counts(count, threads, t.offsets);
+
+    // Pass 2: each edge i -> v of part p takes the next of p's slots in v's range
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int p = 0; p < threads; p++)
+    {
+        Index *next = count + (size_t)p * N;
+        for (int i = part[p]; i < part[p + 1]; i++)
+        {
+            for (Index j = g.offsets[i]; j < g.offsets[i + 1]; j++)
+                t.to[next[g.to[j]]++] = i;
+        }
+    }
+    free(count);
+    return t;
+}
+
+static inline size_t Align8(size_t bytes)
+{
+    return (bytes + 7) & ~(size_t)7;
+}
+
+// Function to continue a 64-bit FNV-1a hash over the 8-byte words of data, the last word zero-padded
+uint64_t Checksum(const void *data, size_t bytes, uint64_t hash)
+{
+    const char *p = (const char *)data;
+    for (size_t i = 0; i < bytes; i += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, p + i, min((size_t)8, bytes - i));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+const uint64_t CHECKSUM_SEED = 0xcbf29ce484222325ULL;
+
+// Function to place the arrays of a binary graph: returns the file size
+size_t Graph_Layout(const Graph_Header &header, size_t *to_at, size_t *weight_at)
+{
+    size_t index = header.flags & GRAPH_64BIT_OFFSETS ? 8 : 4;
+    *to_at = Align8(sizeof(Graph_Header) + (header.nodes + 1) * index);
+    *weight_at = Align8(*to_at + header.edges * sizeof(int));
+    return *weight_at + (header.flags & GRAPH_WEIGHTED ? header.edges * sizeof(double) : 0);
+}
+
+// Function to write a CSR graph as a binary graph file
+template <typename Index>
+void Write_Graph(const CSR<Index> &g, const char *filename)
+{
+    Graph_Header header;
+    memcpy(header.magic, GRAPH_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_VERSION;
+    header.flags = (sizeof(Index) == 8 ? GRAPH_64BIT_OFFSETS : 0) | (g.weight ? GRAPH_WEIGHTED : 0);
+    header.nodes = N;
+    header.edges = g.offsets[N];
+
+    const void *arrays[3] = {g.offsets, g.to, g.weight};
+    size_t bytes[3] = {((size_t)N + 1) * sizeof(Index), header.edges * sizeof(int), g.weight ? header.edges * sizeof(double) : 0};
+    header.checksum = CHECKSUM_SEED;
+    for (int a = 0; a < 3; a++)
+        header.checksum = Checksum(arrays[a], bytes[a], header.checksum);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot create %s\n", filename);
+        exit(1);
+    }
+    const char padding[8] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int a = 0; a < 3 && ok; a++)
+    {
+        ok = fwrite(arrays[a], 1, bytes[a], file) == bytes[a];
+        ok = ok && fwrite(padding, 1, Align8(bytes[a]) - bytes[a], file) == Align8(bytes[a]) - bytes[a];
+    }
+    if (fclose(file) != 0 || !ok)
+    {
+        fprintf(stderr, "Cannot write %s\n", filename);
+        exit(1);
+    }
+}
+
+// Function to map a binary graph file. Returns false if the file is not one (so it is parsed as
+// text); exits if it is one but is truncated, of another version or fails its checksum.
+bool Map_Graph(const char *filename, Graph_File *file)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(Graph_Header) ||
+        pread(fd, &file->header, sizeof(Graph_Header), 0) != sizeof(Graph_Header) ||
+        memcmp(file->header.magic, GRAPH_MAGIC, sizeof(GRAPH_MAGIC)) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    const Graph_Header &header = file->header;
+    size_t to_at, weight_at;
+    if (header.version != GRAPH_VERSION || header.nodes == 0 || header.nodes > INT_MAX ||
+        header.edges > (size_t)st.st_size || Graph_Layout(header, &to_at, &weight_at) != (size_t)st.st_size)
+    {
+        fprintf(stderr, "%s is not a valid version %u graph file\n", filename, GRAPH_VERSION);
+        exit(1);
+    }
+
+    file->size = st.st_size;
+    file->data = (const char *)mmap(NULL, file->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (file->data == MAP_FAILED)
+    {
+        fprintf(stderr, "Cannot map %s\n", filename);
+        exit(1);
+    }
+    if (Checksum(file->data + sizeof(Graph_Header), file->size - sizeof(Graph_Header), CHECKSUM_SEED) != header.checksum)
+    {
+        fprintf(stderr, "Checksum mismatch in %s\n", filename);
+        exit(1);
+    }
+    N = header.nodes;
+    return true;
+}
+
+// Function to use the arrays of a mapped binary graph file directly as a CSR graph
+template <typename Index>
+CSR<Index> Graph_View(const Graph_File &file)
+{
+    size_t to_at, weight_at;
+    Graph_Layout(file.header, &to_at, &weight_at);
+    CSR<Index> g;
+    g.offsets = (Index *)(file.data + sizeof(Graph_Header));
+    g.to = (int *)(file.data + to_at);
+    g.weight = file.header.flags & GRAPH_WEIGHTED ? (double *)(file.data + weight_at) : NULL;
+    if (g.offsets[0] != 0 || g.offsets[N] != file.header.edges)
+    {
+        fprintf(stderr, "Inconsistent offsets in the graph file\n");
+        exit(1);
+    }
+    return g;
+}
+
+// Function to report the resident memory of the process in MB: current and peak
+void Memory_Usage(double *current, double *peak)
+{
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(statm);
+    }
+    *current = resident * (double)sysconf(_SC_PAGESIZE) / (1 << 20);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    *peak = usage.ru_maxrss / 1024.0;
+}
+
 // Function to calculate the difference between ri and rj (for convergence check)
 double diff()
 {
@@ -87,48 +572,28 @@ double diff()
     return sum;
 }
 
-int main(int argc, char **argv)
+// Function to run PageRank on the CSR graph until the error falls below the threshold
+template <typename Index>
+void PageRank(const CSR<Index> &g)
 {
-    const char *filename = "./soc-Stanford.txt"; // Input file name
-    N = 281903;           // Number of nodes
-    threshold = 0.0001;    // Convergence threshold
-    d = 0.85;              // Damping factor for PageRank
-    threads = 1;           // Default number of threads
-    int mode = 1;          // Mode for reading input graph (0 = edgelist, 1 = txt)
-
-    // Override default parameters with command-line arguments
-    if (argc >= 2)
-        filename = argv[1];
-    if (argc >= 3)
-        N = atoi(argv[2]);
-    if (argc >= 4)
-        threshold = atof(argv[3]);
-    if (argc >= 5)
-        d = atof(argv[4]);
-    if (argc >= 6)
-        threads = atoi(argv[5]);
-    if (argc >= 7)
-        mode = atoi(argv[6]);
-
-    printf("Filename = %s, Threshold = %f, Damping Factor = %f, Threads = %d\n", filename, threshold, d, threads);
-
-    // Allocate memory for the graph nodes
-    Nodes = new Node[N];
+    int iterations = 0;
+    double error = 1;  // Initialize error for convergence loop
 
-    // Initialize the node data
-#pragma omp parallel for num_threads(threads)
-    for (int i = 0; i < N; i++)
+    // The pull engine reads in-edges: build the transposed graph once, and split the nodes into
+    // one range per thread holding about the same number of in-edges plus nodes
+    CSR<Index> in = {NULL, NULL, NULL};
+    vector<int> part(threads + 1, N);
+    double *contrib = NULL;
+    if (pull)
     {
-        Nodes[i].outd = 0;
-        Nodes[i].to = new int[1];
+        auto start = chrono::high_resolution_clock::now();
+        in = Transpose(g);
+        part = Split_Nodes(in, threads);
+        contrib = (double *)malloc(N * sizeof(double));
+        auto end = chrono::high_resolution_clock::now();
+        printf("Transpose Time = %f\n", chrono::duration<double>(end - start).count());
     }
 
-    // Read the graph from the input file
-    Read_Graph((char *)filename, mode);
-
-    int iterations = 0;
-    double error = 1;  // Initialize error for convergence loop
-
     // Loop until the error is below the threshold
     while (error > threshold)
     {
@@ -136,24 +601,55 @@ int main(int argc, char **argv)
 
         // Swap ri and rj to start the next iteration
         swap(ri, rj);
-        fill(rj, rj + N, 0.0);  // Reset rj for new values
 
         // PageRank formula:
-        // rj[node] += d * ri[i] / Nodes[i].outd
+        // rj[node] += d * ri[i] / outd
         // where:
         // - d is the damping factor
         // - ri[i] is the rank of node i in the previous iteration
-        // - Nodes[i].outd is the out-degree of node i
+        // - outd is the out-degree of node i
         // This computes the portion of node i's rank distributed to node j
 
-#pragma omp parallel for num_threads(threads) schedule(dynamic)
-        for (int i = 0; i < N; i++)
+        if (pull)
         {
-            for (int j = 0; j < Nodes[i].outd; j++)
+            // Every node's share d * ri[i] / outd, computed once instead of once per out-edge
+#pragma omp parallel for num_threads(threads)
+            for (int i = 0; i < N; i++)
             {
-                int node = Nodes[i].to[j];  // Get the node to which i points
+                int outd = g.offsets[i + 1] - g.offsets[i];
+                contrib[i] = outd ? d * ri[i] / outd : 0.0;
+            }
+
+            // Each thread sums the shares arriving at the nodes of its own range: no atomics
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+            for (int t = 0; t < threads; t++)
+            {
+                for (int v = part[t]; v < part[t + 1]; v++)
+                {
+                    double sum = 0.0;
+                    for (Index j = in.offsets[v]; j < in.offsets[v + 1]; j++)
+                    {
+                        sum += contrib[in.to[j]];
+                    }
+                    rj[v] = sum;
+                }
+            }
+        }
+        else
+        {
+            fill(rj, rj + N, 0.0);  // Reset rj for new values
+
+#pragma omp parallel for num_threads(threads) schedule(dynamic)
+            for (int i = 0; i < N; i++)
+            {
+                Index begin = g.offsets[i], end = g.offsets[i + 1];
+                int outd = end - begin;
+                for (Index j = begin; j < end; j++)
+                {
+                    int node = g.to[j];  // Get the node to which i points
 #pragma omp atomic
-                rj[node] += d * ri[i] / Nodes[i].outd;
+                    rj[node] += d * ri[i] / outd;
+                }
             }
         }
 
@@ -189,12 +685,123 @@ int main(int argc, char **argv)
     double total_time = accumulate(times.begin(), times.end(), 0.0);
     printf("Total Time = %f\n", total_time);
 
-    // Free allocated memory
-    for (int i = 0; i < N; i++)
+    if (pull)
+    {
+        free(contrib);
+        Free_CSR(in);
+    }
+}
+
+// Function to report how long it took to get the graph into memory, then run PageRank on it
+template <typename Index>
+void Run(const CSR<Index> &g, chrono::high_resolution_clock::time_point start)
+{
+    auto end = chrono::high_resolution_clock::now();
+
+    double current, peak;
+    Memory_Usage(&current, &peak);
+    printf("Ingest Time = %f, Offsets = %d-bit, Resident Memory = %.1f MB (peak %.1f MB)\n",
+           chrono::duration<double>(end - start).count(), (int)sizeof(Index) * 8, current, peak);
+
+    Init_Ranks();
+    PageRank(g);
+}
+
+// Function to build the CSR graph with the narrowest offsets that fit, then run PageRank on it or
+// write it to a binary graph file
+template <typename Index>
+void Build_And_Run(chrono::high_resolution_clock::time_point start, const char *output)
+{
+    CSR<Index> g = Build_CSR<Index>();
+    if (output)
+    {
+        Write_Graph(g, output);
+        printf("Wrote %s\n", output);
+    }
+    else
     {
-        delete[] Nodes[i].to;
+        Run(g, start);
     }
-    delete[] Nodes;
+    Free_CSR(g);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = "./soc-Stanford.txt"; // Input file name
+    N = 0;                 // Number of nodes (0 = largest node id in the file + 1)
+    threshold = 0.0001;    // Convergence threshold
+    d = 0.85;              // Damping factor for PageRank
+    threads = 1;           // Default number of threads
+    int mode = 1;          // Mode for reading input graph (0 = edgelist, 1 = txt)
+    bool remap = false;    // Renumber sparse node ids densely
+    pull = false;          // PageRank engine (push = atomics along out-edges, pull = sums over in-edges)
+
+    // Convert a text graph to a binary graph file once, so later runs can map it instead of parsing
+    if (argc >= 4 && strcmp(argv[1], "convert") == 0)
+    {
+        if (argc >= 5)
+            mode = atoi(argv[4]);
+        if (argc >= 6)
+            remap = atoi(argv[5]);
+        if (argc >= 7)
+            threads = max(1, atoi(argv[6]));
+        Read_Graph(argv[2], mode, remap);
+        size_t edges = 0;
+        for (auto &chunk : chunks)
+            edges += chunk.src.size();
+        if (edges > UINT32_MAX)
+            Build_And_Run<uint64_t>(chrono::high_resolution_clock::now(), argv[3]);
+        else
+            Build_And_Run<uint32_t>(chrono::high_resolution_clock::now(), argv[3]);
+        return 0;
+    }
+
+    // Override default parameters with command-line arguments
+    if (argc >= 2)
+        filename = argv[1];
+    if (argc >= 3)
+        N = atoi(argv[2]);
+    if (argc >= 4)
+        threshold = atof(argv[3]);
+    if (argc >= 5)
+        d = atof(argv[4]);
+    if (argc >= 6)
+        threads = atoi(argv[5]);
+    if (argc >= 7)
+        mode = atoi(argv[6]);
+    if (argc >= 8)
+        remap = atoi(argv[7]);
+    if (argc >= 9)
+        pull = strcmp(argv[8], "pull") == 0;
+    if (threads < 1)
+        threads = 1;
+
+    printf("Filename = %s, Threshold = %f, Damping Factor = %f, Threads = %d, Engine = %s\n", filename, threshold, d,
+           threads, pull ? "pull" : "push");
+
+    // Map a binary graph file and use its arrays in place, or read the graph from the text file and build the CSR graph
+    auto start = chrono::high_resolution_clock::now();
+    Graph_File file;
+    if (Map_Graph(filename, &file))
+    {
+        if (file.header.flags & GRAPH_64BIT_OFFSETS)
+            Run(Graph_View<uint64_t>(file), start);
+        else
+            Run(Graph_View<uint32_t>(file), start);
+        munmap((void *)file.data, file.size);
+    }
+    else
+    {
+        Read_Graph((char *)filename, mode, remap);
+        size_t edges = 0;
+        for (auto &chunk : chunks)
+            edges += chunk.src.size();
+        if (edges > UINT32_MAX)
+            Build_And_Run<uint64_t>(start, NULL);
+        else
+            Build_And_Run<uint32_t>(start, NULL);
+    }
+
     free(ri);
     free(rj);
 
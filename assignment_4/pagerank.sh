@@ -15,30 +15,35 @@ run_executable() {
     THRESHOLD=$3
     DAMPING=$4
     NUM_THREADS=$5
+    MODE=$6
+    ENGINE=$7
 
     export OMP_NUM_THREADS=$NUM_THREADS
 
-    echo "Running with FILENAME=$FILENAME, N=$N, THRESHOLD=$THRESHOLD, DAMPING=$DAMPING, NUM_THREADS=$NUM_THREADS"
+    echo "Running with FILENAME=$FILENAME, N=$N, THRESHOLD=$THRESHOLD, DAMPING=$DAMPING, NUM_THREADS=$NUM_THREADS, ENGINE=$ENGINE"
     
     # Capture the output of the program
-    output=$(./a.out $FILENAME $N $THRESHOLD $DAMPING $NUM_THREADS)
+    output=$(./a.out $FILENAME $N $THRESHOLD $DAMPING $NUM_THREADS $MODE 0 $ENGINE)
     
-    # Extract total time using pattern matching
+    # Extract the node count (N=0 lets the program find it), ingest and total time using pattern matching
+    nodes=$(echo "$output" | grep -oP 'Nodes = \K\d+')
+    ingest_time=$(echo "$output" | grep -oP 'Ingest Time = \K[\d.]+')
     total_time=$(echo "$output" | grep -oP 'Total Time = \K[\d.]+')
 
     # Log the results
-    echo "$N, $NUM_THREADS, $total_time" >> performance_data.csv
-    echo "Num Threads: $NUM_THREADS, Total Time: $total_time seconds"
+    echo "$nodes, $NUM_THREADS, $ENGINE, $ingest_time, $total_time" >> performance_data.csv
+    echo "Engine: $ENGINE, Num Threads: $NUM_THREADS, Total Time: $total_time seconds"
+    echo "$output" | grep "Ingest Time"
     echo "----------------------------------------"
 }
 
 # Remove previous performance data
 rm -f performance_data.csv
-echo "N, NumThreads, TotalTime" > performance_data.csv
+echo "N, NumThreads, Engine, IngestTime, TotalTime" > performance_data.csv
 
 # Parameters for input sizes and number of threads
 FILENAME="./web-Stanford.txt"
-N=281903
+N=0
 THRESHOLD=0.0001
 DAMPING=0.85
 MODE=1
@@ -46,7 +51,14 @@ MODE=1
 # Array for varying number of threads
 NUM_THREADS=(1 2 4 8 10 12 14 16 18 20)
 
-# Run the executable with varying number of threads
-for THREADS in "${NUM_THREADS[@]}"; do
-    run_executable $FILENAME $N $THRESHOLD $DAMPING $THREADS $MODE
+# Parse the text graph once into a binary graph file; every run below maps it instead of parsing
+BINARY="./web-Stanford.bin"
+./a.out convert $FILENAME $BINARY $MODE
+
+# Run the executable with varying number of threads, pushing rank with atomics and pulling it over in-edges;
+# push is the program's default engine, pull has to be asked for with the eighth argument
+for ENGINE in push pull; do
+    for THREADS in "${NUM_THREADS[@]}"; do
+        run_executable $BINARY $N $THRESHOLD $DAMPING $THREADS $MODE $ENGINE
+    done
 done
@@ -5,6 +5,7 @@ filename = 'my_super_job.o'
 
 num_threads = []
 times = []
+engines = {}  # engine -> ([threads], [times])
 
 # Reading the file
 with open(filename, 'r') as file:
@@ -12,14 +13,21 @@ with open(filename, 'r') as file:
         # Extract data from each line
         if "Num Threads:" in line and "Total Time:" in line:
             # Split based on the pattern in your file
+            engine = line.split("Engine:")[1].split(",")[0].strip() if "Engine:" in line else "push"
             threads = int(line.split("Num Threads:")[1].split(",")[0].strip())
             time = float(line.split("Total Time:")[1].strip().split()[0])
             num_threads.append(threads)
             times.append(time)
+            engines.setdefault(engine, ([], []))
+            engines[engine][0].append(threads)
+            engines[engine][1].append(time)
 
 # Plotting
 plt.figure(figsize=(10, 6))
-plt.plot(num_threads, times, marker='o', linestyle='-', color='b', label='Total Time')
+colors = {'push': 'b', 'pull': 'g'}
+for engine, (engine_threads, engine_times) in engines.items():
+    plt.plot(engine_threads, engine_times, marker='o', linestyle='-', color=colors.get(engine, 'k'),
+             label=f'Total Time ({engine})')
 
 # Annotate each point with time value
 for i, time in enumerate(times):